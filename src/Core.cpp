@@ -0,0 +1,1501 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "Core.h"
+#ifdef CHIP8_PROFILER
+#include <chrono>
+#endif
+
+// Default font for the chip-8
+const uint8_t chip8_core::font[80] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+chip8_core::chip8_core()
+{
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        memory[i] = 0;
+    }
+    set_speed(700);
+    timing = timing_flat;
+    seed(1);
+    select_profile(profile_cosmac_vip);
+    load(nullptr, 0);
+}
+
+chip8_core::~chip8_core()
+{
+    delete recompiler;
+}
+
+bool chip8_core::load(const std::string& game)
+{
+	// Load rom from the file
+	std::ifstream ifs;
+	ifs.open(game, std::ifstream::binary);
+	if (!ifs.is_open())
+	{
+		return false;
+	}
+
+	ifs.seekg(0, std::ios::end);
+	std::streampos file_size = ifs.tellg();
+	ifs.seekg(0, std::ios::beg);
+    std::vector<uint8_t> data((size_t)file_size);
+	ifs.read(reinterpret_cast<char*>(data.data()), file_size);
+    ifs.close();
+    return load(data.data(), data.size());
+}
+
+bool chip8_core::load(const uint8_t* data, size_t size)
+{
+    // Anything past the end of memory is dropped
+    if (size > sizeof(memory) - 0x200)
+        size = sizeof(memory) - 0x200;
+    rom.assign(data, data + size);
+
+    // Initialize 4KB memory
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        memory[i] = 0;
+    }
+    flush_decoded();
+
+	// Initialize font
+	// Stored at 0x50 to 0x9F
+	for (uint8_t i = 0; i < 80; i++)
+	{
+		memory[i + 0x50] = font[i];
+	}
+
+	// Load rom into memory
+    for (size_t i = 0; i < rom.size(); i++)
+    {
+        memory[i + 0x200] = rom[i];
+    }
+    fuse_all();
+
+    // Initialize sound timer and delay timer
+    ST = 0;
+    DT = 0;
+
+    // Initialize registers
+    SP = 0;
+    I = 0;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        V[i] = 0;
+    }
+
+    // Initialize keypad
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        keypad[i] = false;
+    }
+
+    // Initialize display array
+    memset(display, 0, sizeof(display));
+    dirty_rows = 0xFFFFFFFF;
+
+    // Initialize variables
+    sound = false;
+    pressed_key = -1;
+    halted = false;
+    key_register = 0;
+    halted_instructions = 0;
+    clear_fusion_counts();
+    trap_count = 0;
+    trapped_opcode = 0;
+    frame_wait = false;
+    loop_index = 0;
+    instruction_count = 0;
+#ifdef CHIP8_PROFILER
+    clear_profile();
+#endif
+    cycle_budget = vip_frame_cycles;
+    random_state = random_seed;
+
+    // Initialize stack
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        stack[i] = 0;
+    }
+    stack_faults = 0;
+
+	// Point Program counter to start of memory
+	PC = 0x200;
+    return true;
+}
+
+void chip8_core::reset()
+{
+    // Clear registers and screen
+    PC = 0x200;
+    ST = 0;
+    DT = 0;
+    SP = 0;
+    I = 0;
+    halted = false;
+    clear_screen({});
+
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        V[i] = 0;
+    }
+
+    // Clear game memory and stack
+    for (uint16_t i = 0x200; i < 4096; i++)
+    {
+        memory[i] = 0x00;
+    }
+    flush_decoded();
+
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        stack[i] = 0;
+    }
+
+    // Reload rom into memory
+    for (size_t i = 0; i < rom.size(); i++)
+    {
+        memory[i + 0x200] = rom[i];
+    }
+    fuse_all();
+    clear_fusion_counts();
+    loop_index = 0;
+    cycle_budget = vip_frame_cycles;
+    random_state = random_seed;
+}
+
+bool chip8_core::enable_jit()
+{
+#ifdef CHIP8_PROFILER
+    // Translated blocks would run past the per-instruction counters
+    return false;
+#endif
+    if (recompiler != nullptr)
+        return true;
+
+    recompiler = new jit();
+    if (!recompiler->init())
+    {
+        delete recompiler;
+        recompiler = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void chip8_core::disable_jit()
+{
+    delete recompiler;
+    recompiler = nullptr;
+}
+
+void chip8_core::step()
+{
+    if (timing == timing_vip)
+    {
+        execute_vip();
+        if (cycle_budget <= 0)
+            end_frame();
+        return;
+    }
+
+    // Runs a single instruction, so no superinstruction or idle loop is skipped over
+    loop_index += execute(1);
+    if (loop_index >= IPF)
+        end_frame();
+}
+
+void chip8_core::run_frame()
+{
+    if (timing == timing_vip)
+    {
+        while (cycle_budget > 0)
+        {
+            execute_vip();
+        }
+        end_frame();
+        return;
+    }
+
+    // Runs what is left of the frame's instruction budget
+    while (loop_index < IPF)
+    {
+        // Runs whole translated blocks while they fit in the frame's budget
+        if (recompiler != nullptr && !halted && PC < 0x1000)
+        {
+            jit::block* block = recompiler->lookup(PC);
+            if (block == nullptr)
+                block = recompiler->translate(*this, PC);
+            if (block != nullptr && loop_index + block->length <= IPF)
+            {
+                block->code(this);
+                loop_index += block->length;
+                if (frame_wait)
+                {
+                    frame_wait = false;
+                    if (halted)
+                        halted_instructions += IPF - loop_index;
+                    else
+                        idle_instructions += IPF - loop_index;
+                    loop_index = IPF;
+                }
+                continue;
+            }
+        }
+
+        loop_index += execute(IPF - loop_index);
+    }
+    end_frame();
+}
+
+void chip8_core::end_frame()
+{
+    // Update timers
+    sound = ST > 0;
+    if (ST > 0) ST--;
+    if (DT > 0) DT--;
+
+    instruction_count += loop_index;
+    loop_index = 0;
+    next_budget();
+    if (timing == timing_vip)
+        cycle_budget += vip_frame_cycles;
+}
+
+void chip8_core::set_speed(uint32_t ips)
+{
+    IPS = ips;
+    speed_remainder = 0;
+    next_budget();
+}
+
+void chip8_core::next_budget()
+{
+    // Carries the remainder of IPS / 60 over, so 700 IPS runs 11, 12, 12 instructions
+    // per frame instead of losing 40 instructions a second
+    speed_remainder += IPS;
+    IPF = speed_remainder / 60;
+    speed_remainder %= 60;
+}
+
+void chip8_core::set_timing(uint8_t model)
+{
+    timing = model;
+    cycle_budget = vip_frame_cycles;
+}
+
+// The VIP runs 1.76064 MHz / 8 = 220080 machine cycles a second, 3668 per frame.
+// Display DMA takes 1024 of them and the interrupt routine about 46 more.
+const double chip8_core::vip_frame_cycles = 1760640.0 / 8 / 60 - 1024 - 46;
+
+// Machine cycles of each instruction in the VIP interpreter, before data dependent costs.
+// [T] is the published VIP timing table (J. Sommerich, "Chip-8 Instruction Scheduling and
+// Frequency", 2019), counted from the interpreter listing in the RCA VIP manual (VIP-311).
+// [M] is modelled here at two machine cycles per 1802 instruction, where [T] gives none.
+const uint16_t chip8_core::vip_cycles[op_count] = {
+    10,   // 0NNN [M], the call and return around a machine code routine of unknown length
+    24,   // 00E0 [T], plus the clear below
+    10,   // 00EE [T]
+    12,   // 1NNN [T]
+    26,   // 2NNN [T]
+    10,   // 3XNN [T], 14 when taken
+    10,   // 4XNN [T], 14 when taken
+    14,   // 5XY0 [T], 18 when taken
+    6,    // 6XNN [T]
+    10,   // 7XNN [T]
+    44,   // 8XY0 [T], all 8XYN run the same self-modified ALU sequence
+    44,   // 8XY1 [T]
+    44,   // 8XY2 [T]
+    44,   // 8XY3 [T]
+    44,   // 8XY4 [T]
+    44,   // 8XY5 [T]
+    44,   // 8XY6 [T]
+    44,   // 8XY7 [T]
+    44,   // 8XYE [T]
+    14,   // 9XY0 [T], 18 when taken
+    12,   // ANNN [T]
+    22,   // BNNN [T], 24 across a page
+    36,   // CXNN [T]
+    22,   // DXYN [T], plus the rows below
+    14,   // EX9E [T], 18 when taken
+    14,   // EXA1 [T], 18 when taken
+    10,   // FX07 [T]
+    10,   // FX15 [T]
+    10,   // FX18 [T]
+    16,   // FX29 [T]
+    80,   // FX33 [T], plus the digits below
+    14,   // FX55 [T], plus the registers below
+    14,   // FX65 [T], plus the registers below
+    16,   // FX1E [T]
+    10    // FX0A [M], one pass of the key poll
+};
+
+uint32_t chip8_core::vip_cost(uint16_t opcode, uint8_t operation) const
+{
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    uint32_t cycles = vip_cycles[operation];
+    switch (operation)
+    {
+        case op_clear_screen:
+            // Zeroes the 256 byte display page a byte at a time [T]
+            cycles += 256 * 12;
+            break;
+        case op_draw:
+        {
+            // Each row XORs the sprite byte into the display in 46 cycles [M]. A sprite that is
+            // not byte aligned is first shifted right one bit at a time into a second byte,
+            // 18 cycles a bit, and that byte is XORed into the next display byte for 20 more.
+            // Rows past the bottom edge are not drawn unless sprites wrap.
+            uint8_t shift = V[x] & 7;
+            uint32_t rows = opcode & 0x000F;
+            if (!active_quirks->wrapping)
+                rows = std::min<uint32_t>(rows, 32 - (V[y] & 31));
+            cycles += rows * (46 + (shift == 0 ? 0 : 20 + 18 * shift));
+            break;
+        }
+        case op_decimal_conversion:
+            // Each digit is found by repeated subtraction [T]
+            cycles += 16 * (V[x] / 100 + V[x] / 10 % 10 + V[x] % 10);
+            break;
+        case op_store_memory:
+        case op_load_memory:
+            // One load and one store per register [T]
+            cycles += 14 * (x + 1);
+            break;
+        case op_offset_jump:
+        {
+            // Crossing a page costs an extra branch [T]
+            uint8_t offset = active_quirks->jumping ? V[x] : V[0];
+            if ((opcode & 0xFF) + offset > 0xFF)
+                cycles += 2;
+            break;
+        }
+    }
+    return cycles;
+}
+
+void chip8_core::execute_vip()
+{
+    // Runs one instruction and charges it the machine cycles the VIP would have spent on it
+    uint16_t address = PC & 0xFFF;
+    uint16_t opcode = (memory[address] << 8) | memory[(address + 1) & 0xFFF];
+    uint8_t operation = halted ? (uint8_t)op_get_key : dispatch_table[opcode];
+    uint32_t cycles = vip_cost(opcode, operation);
+
+    execute(1);
+    loop_index++;
+
+    // FX0A and DXYN under display wait only continue after the next interrupt
+    if (halted || (operation == op_draw && (PC & 0xFFF) == address))
+    {
+        cycle_budget = 0;
+        return;
+    }
+
+    // Taken skips cost one more branch [T]
+    switch (operation)
+    {
+        case op_equal_skip:
+        case op_unequal_skip:
+        case op_equal_register_skip:
+        case op_unequal_register_skip:
+        case op_skip_if_key:
+        case op_skip_if_not_key:
+            if (((PC - address) & 0xFFF) == 4)
+                cycles += 4;
+            break;
+    }
+    cycle_budget -= cycles;
+}
+
+void chip8_core::seed(uint32_t value)
+{
+    // Xorshift never leaves a zero state, so zero is swapped for another seed
+    random_seed = value != 0 ? value : 0x9E3779B9;
+    random_state = random_seed;
+}
+
+void chip8_core::save_state(state& snapshot) const
+{
+    memcpy(snapshot.memory, memory, sizeof(memory));
+    memcpy(snapshot.V, V, sizeof(V));
+    snapshot.I = I;
+    snapshot.PC = PC;
+    snapshot.SP = SP;
+    memcpy(snapshot.stack, stack, sizeof(stack));
+    snapshot.DT = DT;
+    snapshot.ST = ST;
+    memcpy(snapshot.keypad, keypad, sizeof(keypad));
+    memcpy(snapshot.display, display, sizeof(display));
+    snapshot.sound = sound;
+    snapshot.pressed_key = pressed_key;
+    snapshot.halted = halted;
+    snapshot.key_register = key_register;
+    snapshot.loop_index = loop_index;
+    snapshot.IPF = IPF;
+    snapshot.speed_remainder = speed_remainder;
+    snapshot.cycle_budget = cycle_budget;
+    snapshot.random_state = random_state;
+    snapshot.instruction_count = instruction_count;
+}
+
+void chip8_core::load_state(const state& snapshot)
+{
+    // Only addresses whose bytes differ lose their decoded instructions, so restoring
+    // a recent state keeps the caches warm
+    uint16_t changed[4096];
+    uint16_t changed_count = 0;
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        if (memory[i] != snapshot.memory[i])
+            changed[changed_count++] = i;
+    }
+    memcpy(memory, snapshot.memory, sizeof(memory));
+    if (changed_count > 256)
+    {
+        flush_decoded();
+        fuse_all();
+    }
+    else
+    {
+        for (uint16_t i = 0; i < changed_count; i++)
+        {
+            invalidate(changed[i]);
+        }
+    }
+
+    memcpy(V, snapshot.V, sizeof(V));
+    I = snapshot.I;
+    PC = snapshot.PC;
+    SP = snapshot.SP;
+    memcpy(stack, snapshot.stack, sizeof(stack));
+    DT = snapshot.DT;
+    ST = snapshot.ST;
+    memcpy(keypad, snapshot.keypad, sizeof(keypad));
+    // Only rows that look different need drawing again
+    for (uint8_t y = 0; y < 32; y++)
+    {
+        if (display[y] != snapshot.display[y])
+            dirty_rows |= 1u << y;
+    }
+    memcpy(display, snapshot.display, sizeof(display));
+    sound = snapshot.sound;
+    pressed_key = snapshot.pressed_key;
+    halted = snapshot.halted;
+    key_register = snapshot.key_register;
+    loop_index = snapshot.loop_index;
+    IPF = snapshot.IPF;
+    speed_remainder = snapshot.speed_remainder;
+    cycle_budget = snapshot.cycle_budget;
+    random_state = snapshot.random_state;
+    instruction_count = snapshot.instruction_count;
+    frame_wait = false;
+}
+
+void chip8_core::save_statistics(statistics& snapshot) const
+{
+    snapshot.stack_faults = stack_faults;
+    snapshot.halted_instructions = halted_instructions;
+    memcpy(snapshot.fused_count, fused_count, sizeof(fused_count));
+    snapshot.fused_instructions = fused_instructions;
+    snapshot.idle_instructions = idle_instructions;
+    snapshot.trap_count = trap_count;
+    snapshot.trapped_opcode = trapped_opcode;
+#ifdef CHIP8_PROFILER
+    snapshot.profile = profile;
+#endif
+}
+
+void chip8_core::load_statistics(const statistics& snapshot)
+{
+    stack_faults = snapshot.stack_faults;
+    halted_instructions = snapshot.halted_instructions;
+    memcpy(fused_count, snapshot.fused_count, sizeof(fused_count));
+    fused_instructions = snapshot.fused_instructions;
+    idle_instructions = snapshot.idle_instructions;
+    trap_count = snapshot.trap_count;
+    trapped_opcode = snapshot.trapped_opcode;
+#ifdef CHIP8_PROFILER
+    profile = snapshot.profile;
+#endif
+}
+
+bool chip8_core::save_state(const std::string& path) const
+{
+    state snapshot;
+    save_state(snapshot);
+    std::vector<uint8_t> data;
+    serialize(snapshot, data);
+
+    std::ofstream ofs(path, std::ofstream::binary);
+    if (!ofs.is_open())
+        return false;
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return ofs.good();
+}
+
+bool chip8_core::load_state(const std::string& path)
+{
+    std::ifstream ifs(path, std::ifstream::binary);
+    if (!ifs.is_open())
+        return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    state snapshot;
+    if (!deserialize(data, snapshot))
+        return false;
+    load_state(snapshot);
+    return true;
+}
+
+void chip8_core::serialize(const state& snapshot, std::vector<uint8_t>& data) const
+{
+    // Little endian fields after a magic number, the format version and a hash of the
+    // ROM the state belongs to. Pixels are packed a bit each, 64 to a row with x = 0 first.
+    data.clear();
+    auto put = [&data](uint64_t value, uint8_t bytes)
+    {
+        for (uint8_t i = 0; i < bytes; i++)
+        {
+            data.push_back((value >> (i * 8)) & 0xFF);
+        }
+    };
+
+    data.insert(data.end(), { 'C', '8', 'S', 'T' });
+    put(state_version, 2);
+    put(rom_hash(), 8);
+    data.insert(data.end(), snapshot.memory, snapshot.memory + 4096);
+    data.insert(data.end(), snapshot.V, snapshot.V + 16);
+    put(snapshot.I, 2);
+    put(snapshot.PC, 2);
+    put(snapshot.SP, 1);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        put(snapshot.stack[i], 2);
+    }
+    put(snapshot.DT, 1);
+    put(snapshot.ST, 1);
+
+    uint16_t keys = 0;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        keys |= snapshot.keypad[i] << i;
+    }
+    put(keys, 2);
+    for (uint8_t y = 0; y < 32; y++)
+    {
+        put(snapshot.display[y], 8);
+    }
+
+    put(snapshot.sound, 1);
+    put((uint8_t)snapshot.pressed_key, 1);
+    put(snapshot.halted, 1);
+    put(snapshot.key_register, 1);
+    put(snapshot.loop_index, 4);
+    put(snapshot.IPF, 4);
+    put(snapshot.speed_remainder, 4);
+    uint64_t budget;
+    memcpy(&budget, &snapshot.cycle_budget, sizeof(budget));
+    put(budget, 8);
+    put(snapshot.random_state, 4);
+    put(snapshot.instruction_count, 8);
+}
+
+bool chip8_core::deserialize(const std::vector<uint8_t>& data, state& snapshot) const
+{
+    // Rejects other versions and states saved from a different ROM
+    size_t offset = 0;
+    auto get = [&data, &offset](uint8_t bytes)
+    {
+        uint64_t value = 0;
+        for (uint8_t i = 0; i < bytes; i++)
+        {
+            value |= (uint64_t)data[offset++] << (i * 8);
+        }
+        return value;
+    };
+
+    const size_t size = 4 + 2 + 8 + 4096 + 16 + 2 + 2 + 1 + 32 + 1 + 1 + 2 + 256 + 4 + 12 + 8 + 4 + 8;
+    if (data.size() != size || memcmp(data.data(), "C8ST", 4) != 0)
+        return false;
+    offset = 4;
+    if (get(2) != state_version || get(8) != rom_hash())
+        return false;
+
+    memcpy(snapshot.memory, &data[offset], 4096);
+    offset += 4096;
+    memcpy(snapshot.V, &data[offset], 16);
+    offset += 16;
+    snapshot.I = (uint16_t)get(2);
+    snapshot.PC = (uint16_t)get(2);
+    snapshot.SP = (uint8_t)get(1);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        snapshot.stack[i] = (uint16_t)get(2);
+    }
+    snapshot.DT = (uint8_t)get(1);
+    snapshot.ST = (uint8_t)get(1);
+
+    uint16_t keys = (uint16_t)get(2);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        snapshot.keypad[i] = (keys >> i) & 1;
+    }
+    for (uint8_t y = 0; y < 32; y++)
+    {
+        snapshot.display[y] = get(8);
+    }
+
+    snapshot.sound = get(1) != 0;
+    snapshot.pressed_key = (int8_t)get(1);
+    snapshot.halted = get(1) != 0;
+    snapshot.key_register = (uint8_t)get(1) & 0xF;
+    snapshot.loop_index = (uint32_t)get(4);
+    snapshot.IPF = (uint32_t)get(4);
+    snapshot.speed_remainder = (uint32_t)get(4);
+    uint64_t budget = get(8);
+    memcpy(&snapshot.cycle_budget, &budget, sizeof(budget));
+    snapshot.random_state = (uint32_t)get(4);
+    snapshot.instruction_count = get(8);
+
+    // A corrupt file must not index past the stack or keypad, or leave a frame that never ends
+    if (snapshot.SP > 16 || snapshot.pressed_key > 15 || snapshot.pressed_key < -1)
+        return false;
+    if (snapshot.IPF == 0 || !std::isfinite(snapshot.cycle_budget))
+        return false;
+
+    // Fetches wrap at 4 KB, so PC is wrapped too. I keeps its 16 bits, since FX1E sets VF
+    // when it passes 0xFFF, and every access through it wraps.
+    snapshot.PC &= 0xFFF;
+    return true;
+}
+
+uint64_t chip8_core::rom_hash() const
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (uint8_t byte : rom)
+    {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t chip8_core::framebuffer_hash() const
+{
+    // FNV-1a over every pixel, column by column, as when the display was a byte per pixel
+    uint64_t hash = 1469598103934665603ULL;
+    for (uint8_t x = 0; x < 64; x++)
+    {
+        for (uint8_t y = 0; y < 32; y++)
+        {
+            hash = (hash ^ ((display[y] >> (63 - x)) & 1)) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+void chip8_core::set_keys(uint16_t keys)
+{
+    // Bit N holds key N
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        keypad[i] = (keys >> i) & 1;
+    }
+}
+
+uint8_t chip8_core::read(uint16_t program_counter)
+{
+    // Addresses wrap at 4 KB, so an instruction at 0xFFF takes its low byte from 0x000
+	return memory[program_counter & 0xFFF];
+}
+
+uint16_t chip8_core::fetch(uint16_t& program_counter)
+{
+    // Gets the 16 bit instruction
+	uint16_t hiByte = read(program_counter);
+	program_counter++;
+	uint16_t loByte = read(program_counter);
+    program_counter++;
+
+	uint16_t opcode = (hiByte << 8) | loByte;
+	return opcode;
+}
+
+void chip8_core::decode(uint16_t opcode)
+{
+    // Decodes and runs the opcode
+    micro_op op = predecode(opcode);
+    (this->*op.handler)(op);
+}
+
+chip8_core::micro_op chip8_core::predecode(uint16_t opcode)
+{
+    // Extracts the operands once and looks up the handler for the opcode
+    micro_op op;
+    op.handler = active_handlers[dispatch_table[opcode]];
+    op.opcode = opcode;
+    op.nnn = opcode & 0x0FFF;
+    op.x = (opcode & 0x0F00) >> 8;
+    op.y = (opcode & 0x00F0) >> 4;
+    op.n = opcode & 0x000F;
+    op.nn = opcode & 0x00FF;
+    return op;
+}
+
+constexpr uint8_t chip8_core::classify(uint16_t opcode)
+{
+    switch (opcode & 0xF000)
+    {
+        case 0x0000:
+            if (opcode == 0x00E0) return op_clear_screen;          // 00E0
+            if (opcode == 0x00EE) return op_return_from_subroutine; // 00EE
+            return op_trap;
+        case 0x1000: return op_jump;                  // 1NNN
+        case 0x2000: return op_call_subroutine;       // 2NNN
+        case 0x3000: return op_equal_skip;            // 3XNN
+        case 0x4000: return op_unequal_skip;          // 4XNN
+        case 0x5000: return op_equal_register_skip;   // 5XY0
+        case 0x6000: return op_set_vx;                // 6XNN
+        case 0x7000: return op_add_vx;                // 7XNN
+        case 0x8000:
+            switch (opcode & 0x000F)
+            {
+                case 0x0000: return op_logical_set;              // 8XY0
+                case 0x0001: return op_logical_OR;               // 8XY1
+                case 0x0002: return op_logical_AND;              // 8XY2
+                case 0x0003: return op_logical_XOR;              // 8XY3
+                case 0x0004: return op_logical_add;              // 8XY4
+                case 0x0005: return op_logical_subtract;         // 8XY5
+                case 0x0006: return op_shift_right;              // 8XY6
+                case 0x0007: return op_logical_subtract_reverse; // 8XY7
+                case 0x000E: return op_shift_left;               // 8XYE
+            }
+            return op_trap;
+        case 0x9000: return op_unequal_register_skip; // 9XY0
+        case 0xA000: return op_set_index;             // ANNN
+        case 0xB000: return op_offset_jump;           // BNNN
+        case 0xC000: return op_random;                // CXNN
+        case 0xD000: return op_draw;                  // DXYN
+        case 0xE000:
+            switch (opcode & 0x00FF)
+            {
+                case 0x009E: return op_skip_if_key;     // EX9E
+                case 0x00A1: return op_skip_if_not_key; // EXA1
+            }
+            return op_trap;
+        case 0xF000:
+            switch (opcode & 0x00FF)
+            {
+                case 0x0007: return op_get_delay_timer;    // FX07
+                case 0x000A: return op_get_key;            // FX0A
+                case 0x0015: return op_set_delay_timer;    // FX15
+                case 0x0018: return op_set_sound_timer;    // FX18
+                case 0x001E: return op_add_index;          // FX1E
+                case 0x0029: return op_point_font;         // FX29
+                case 0x0033: return op_decimal_conversion; // FX33
+                case 0x0055: return op_store_memory;       // FX55
+                case 0x0065: return op_load_memory;        // FX65
+            }
+            return op_trap;
+    }
+    return op_trap;
+}
+
+constexpr std::array<uint8_t, 0x10000> chip8_core::build_dispatch_table()
+{
+    std::array<uint8_t, 0x10000> table = {};
+    for (uint32_t opcode = 0; opcode < 0x10000; opcode++)
+    {
+        table[opcode] = classify(opcode);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 0x10000> chip8_core::dispatch_table = chip8_core::build_dispatch_table();
+
+template <typename platform>
+const chip8_core::opcode_handler chip8_core::handlers[op_count] = {
+    &chip8_core::trap, &chip8_core::clear_screen, &chip8_core::return_from_subroutine, &chip8_core::jump, &chip8_core::call_subroutine,
+    &chip8_core::equal_skip, &chip8_core::unequal_skip, &chip8_core::equal_register_skip, &chip8_core::set_vx, &chip8_core::add_vx,
+    &chip8_core::logical_set, &chip8_core::logical_OR<platform>, &chip8_core::logical_AND<platform>, &chip8_core::logical_XOR<platform>, &chip8_core::logical_add,
+    &chip8_core::logical_subtract, &chip8_core::shift_right<platform>, &chip8_core::logical_subtract_reverse, &chip8_core::shift_left<platform>,
+    &chip8_core::unequal_register_skip, &chip8_core::set_index, &chip8_core::offset_jump<platform>, &chip8_core::random, &chip8_core::draw<platform>,
+    &chip8_core::skip_if_key, &chip8_core::skip_if_not_key, &chip8_core::get_delay_timer, &chip8_core::set_delay_timer,
+    &chip8_core::set_sound_timer, &chip8_core::point_font, &chip8_core::decimal_conversion, &chip8_core::store_memory<platform>,
+    &chip8_core::load_memory<platform>, &chip8_core::add_index, &chip8_core::get_key
+};
+
+template <typename platform>
+const chip8_core::fused_handler chip8_core::fused_handlers[fusion_count] = {
+    &chip8_core::set_index_draw<platform>, &chip8_core::wait_delay, &chip8_core::set_vx_pair, &chip8_core::add_carry_skip,
+    &chip8_core::self_jump
+};
+
+const char* chip8_core::profile_names[profile_count] = {
+    "cosmac_vip", "chip48", "schip", "modern",
+    "legacy", "legacy_logic", "legacy_wrapping", "legacy_logic_wrapping",
+    "legacy_wait", "legacy_logic_wait", "legacy_wrapping_wait", "legacy_logic_wrapping_wait"
+};
+
+const chip8_core::quirks chip8_core::profile_quirks[profile_count] = {
+    cosmac_vip::value, chip48::value, schip::value, modern::value,
+    legacy<false, false, false>::value, legacy<true, false, false>::value,
+    legacy<false, true, false>::value, legacy<true, true, false>::value,
+    legacy<false, false, true>::value, legacy<true, false, true>::value,
+    legacy<false, true, true>::value, legacy<true, true, true>::value
+};
+
+uint8_t chip8_core::find_profile(const std::string& name)
+{
+    for (uint8_t i = 0; i < profile_count; i++)
+    {
+        if (name == profile_names[i])
+            return i;
+    }
+    return profile_cosmac_vip;
+}
+
+uint8_t chip8_core::legacy_profile(bool logic, bool wrapping, bool display_wait)
+{
+    return profile_legacy + (logic ? 1 : 0) + (wrapping ? 2 : 0) + (display_wait ? 4 : 0);
+}
+
+template <typename platform>
+void chip8_core::use_profile()
+{
+    active_handlers = handlers<platform>;
+    active_fused = fused_handlers<platform>;
+    active_quirks = &platform::value;
+}
+
+void chip8_core::select_profile(uint8_t profile)
+{
+    // Picks the handler instantiations once, so no handler tests quirks while running
+    selected_profile = profile < profile_count ? profile : (uint8_t)profile_cosmac_vip;
+    switch (selected_profile)
+    {
+        case profile_chip48: use_profile<chip48>(); break;
+        case profile_schip: use_profile<schip>(); break;
+        case profile_modern: use_profile<modern>(); break;
+        case profile_legacy + 0: use_profile<legacy<false, false, false>>(); break;
+        case profile_legacy + 1: use_profile<legacy<true, false, false>>(); break;
+        case profile_legacy + 2: use_profile<legacy<false, true, false>>(); break;
+        case profile_legacy + 3: use_profile<legacy<true, true, false>>(); break;
+        case profile_legacy + 4: use_profile<legacy<false, false, true>>(); break;
+        case profile_legacy + 5: use_profile<legacy<true, false, true>>(); break;
+        case profile_legacy + 6: use_profile<legacy<false, true, true>>(); break;
+        case profile_legacy + 7: use_profile<legacy<true, true, true>>(); break;
+        default: use_profile<cosmac_vip>(); break;
+    }
+
+    // Cached handlers belong to the previous profile
+    flush_decoded();
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        fuse(i);
+    }
+}
+
+uint32_t chip8_core::execute(uint32_t budget)
+{
+    // Runs the instruction at PC from the predecoded cache, decoding it on first use.
+    // A superinstruction is used instead when it fits in the remaining budget.
+    if (halted)
+    {
+        // Keys only change between frames, so one poll covers the whole budget
+        poll_key();
+        if (!halted)
+            return 1;
+        halted_instructions += budget;
+        return budget;
+    }
+
+    uint16_t address = PC & 0xFFF;
+    micro_op& op = decoded[address];
+    if (op.handler == nullptr)
+    {
+        uint16_t program_counter = address;
+        op = predecode(fetch(program_counter));
+    }
+
+    PC += 2;
+    uint32_t executed = 1;
+#ifdef CHIP8_PROFILER
+    profile_instruction(address, op);
+#else
+    const fused_op& fusion = fused[address];
+    if (fusion.handler != nullptr && fusion.length <= budget)
+    {
+        executed = (this->*fusion.handler)(fusion, budget);
+        fused_count[fusion.kind]++;
+        fused_instructions += executed;
+    }
+    else
+        (this->*op.handler)(op);
+#endif
+
+    // Waiting on the display or a key does nothing but repeat itself, so the rest of the frame is skipped
+    if (frame_wait)
+    {
+        frame_wait = false;
+        if (halted)
+            halted_instructions += budget - executed;
+        else
+            idle_instructions += budget - executed;
+        executed = budget;
+    }
+    return executed;
+}
+
+void chip8_core::jit_call(chip8_core* emulator, const micro_op* op)
+{
+    // Called from translated code for instructions that are not emitted inline
+    (emulator->*op->handler)(*op);
+}
+
+void chip8_core::invalidate(uint16_t address)
+{
+    // A write can change the instruction starting at the address or the one before it
+    decoded[address & 0xFFF].handler = nullptr;
+    decoded[(address - 1) & 0xFFF].handler = nullptr;
+    if (recompiler != nullptr)
+        recompiler->invalidate(address);
+
+    // Superinstructions span up to six bytes
+    for (uint16_t i = 0; i < 6; i++)
+    {
+        fuse((address - i) & 0xFFF);
+    }
+}
+
+void chip8_core::flush_decoded()
+{
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        decoded[i].handler = nullptr;
+    }
+    if (recompiler != nullptr)
+        recompiler->flush();
+}
+
+void chip8_core::fuse(uint16_t address)
+{
+    fused_op& fusion = fused[address];
+    fusion.handler = nullptr;
+    if (address > 0xFFA)
+        return;
+
+    uint16_t first = (memory[address] << 8) | memory[address + 1];
+    uint16_t second = (memory[address + 2] << 8) | memory[address + 3];
+    uint16_t third = (memory[address + 4] << 8) | memory[address + 5];
+    fusion.first = predecode(first);
+    fusion.second = predecode(second);
+
+    if (first == (0x1000 | address))
+    {
+        fusion.handler = active_fused[fusion_self_jump];
+        fusion.kind = fusion_self_jump;
+        fusion.length = 1;
+    }
+    else if ((first & 0xF000) == 0xA000 && (second & 0xF000) == 0xD000)
+    {
+        fusion.handler = active_fused[fusion_set_index_draw];
+        fusion.kind = fusion_set_index_draw;
+        fusion.length = 2;
+    }
+    else if ((first & 0xF0FF) == 0xF007 && second == (0x3000 | (first & 0x0F00)) && third == (0x1000 | address))
+    {
+        fusion.handler = active_fused[fusion_wait_delay];
+        fusion.kind = fusion_wait_delay;
+        fusion.length = 3;
+    }
+    else if ((first & 0xF000) == 0x6000 && (second & 0xF000) == 0x6000)
+    {
+        fusion.handler = active_fused[fusion_set_vx_pair];
+        fusion.kind = fusion_set_vx_pair;
+        fusion.length = 2;
+    }
+    else if ((first & 0xF00F) == 0x8004 && second == 0x3F01)
+    {
+        fusion.handler = active_fused[fusion_add_carry_skip];
+        fusion.kind = fusion_add_carry_skip;
+        fusion.length = 2;
+    }
+}
+
+void chip8_core::fuse_all()
+{
+    // Restoring a state also refuses everything, so the statistics are cleared by load and reset
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        fuse(i);
+    }
+}
+
+void chip8_core::clear_fusion_counts()
+{
+    for (uint8_t i = 0; i < fusion_count; i++)
+    {
+        fused_count[i] = 0;
+    }
+    fused_instructions = 0;
+    idle_instructions = 0;
+}
+
+#ifdef CHIP8_PROFILER
+const char* chip8_core::operation_names[op_count] = {
+    "unknown", "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+    "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1", "FX07", "FX15",
+    "FX18", "FX29", "FX33", "FX55", "FX65", "FX1E", "FX0A"
+};
+
+void chip8_core::clear_profile()
+{
+    memset(&profile, 0, sizeof(profile));
+}
+
+void chip8_core::profile_instruction(uint16_t address, const micro_op& op)
+{
+    uint8_t operation = dispatch_table[op.opcode];
+    profile.operations[operation]++;
+    profile.addresses[address]++;
+
+    if (operation == op_draw)
+    {
+        auto start = std::chrono::steady_clock::now();
+        (this->*op.handler)(op);
+        profile.draw_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    else
+        (this->*op.handler)(op);
+}
+#endif
+
+bool chip8_core::idle_loop(uint16_t address) const
+{
+    const fused_op& fusion = fused[address & 0xFFF];
+    return fusion.handler != nullptr && (fusion.kind == fusion_wait_delay || fusion.kind == fusion_self_jump);
+}
+
+// Superinstructions
+template <typename platform>
+uint32_t chip8_core::set_index_draw(const fused_op& op, uint32_t budget)
+{
+    set_index(op.first);
+    PC += 2;
+
+    // Draw sees the same loop index as it would when run on its own
+    loop_index++;
+    draw<platform>(op.second);
+    loop_index--;
+    return 2;
+}
+
+uint32_t chip8_core::wait_delay(const fused_op& op, uint32_t budget)
+{
+    uint16_t address = PC - 2;
+    V[op.first.x] = DT;
+    if (DT == 0)
+    {
+        PC = address + 6;
+        return 2;
+    }
+
+    // The delay timer only ticks between frames, so the loop spins for the rest of
+    // this one. PC ends wherever the last iteration would have stopped.
+    PC = address + (budget % 3) * 2;
+    idle_instructions += budget;
+    return budget;
+}
+
+uint32_t chip8_core::set_vx_pair(const fused_op& op, uint32_t budget)
+{
+    set_vx(op.first);
+    set_vx(op.second);
+    PC += 2;
+    return 2;
+}
+
+uint32_t chip8_core::add_carry_skip(const fused_op& op, uint32_t budget)
+{
+    logical_add(op.first);
+    PC += 2;
+    equal_skip(op.second);
+    return 2;
+}
+
+uint32_t chip8_core::self_jump(const fused_op& op, uint32_t budget)
+{
+    // Nothing can leave the loop, so the rest of the frame is skipped
+    PC -= 2;
+    idle_instructions += budget;
+    return budget;
+}
+
+// Opcodes
+void chip8_core::trap(const micro_op& op)
+{
+    // Unknown opcodes such as 0NNN are recorded and otherwise ignored
+    trapped_opcode = op.opcode;
+    trap_count++;
+}
+
+void chip8_core::clear_screen(const micro_op& op)
+{
+    memset(display, 0, sizeof(display));
+    dirty_rows = 0xFFFFFFFF;
+}
+
+void chip8_core::jump(const micro_op& op)
+{
+	PC = op.nnn;
+}
+
+void chip8_core::call_subroutine(const micro_op& op)
+{
+    // A 17th call overwrites the oldest return address
+    if (SP == 16)
+    {
+        SP = 0;
+        stack_faults++;
+    }
+	stack[SP++] = PC;
+	PC = op.nnn;
+}
+
+void chip8_core::return_from_subroutine(const micro_op& op)
+{
+    // Returning with nothing on the stack pops the top slot
+    if (SP == 0)
+    {
+        SP = 16;
+        stack_faults++;
+    }
+	PC = stack[--SP];
+}
+
+void chip8_core::set_vx(const micro_op& op)
+{
+	V[op.x] = op.nn;
+}
+
+void chip8_core::add_vx(const micro_op& op)
+{
+	V[op.x] += op.nn;
+}
+
+void chip8_core::set_index(const micro_op& op)
+{
+	I = op.nnn;
+}
+
+template <typename platform>
+void chip8_core::draw(const micro_op& op)
+{
+	if constexpr (platform::display_wait)
+	{
+        if (loop_index != 0)
+        {
+            PC -= 2;
+            frame_wait = true;
+            return;
+        }
+	}
+
+    // Each sprite row is shifted into place and XORed with a whole display row. Wrapping
+    // rotates the bits that fall off the right edge back in on the left, clipping drops them.
+    uint8_t x_coor = V[op.x] & 63;
+    uint8_t y_coor = V[op.y] & 31;
+    uint64_t collision = 0;
+    for (uint8_t i = 0; i < op.n; i++)
+    {
+        uint64_t sprite = (uint64_t)memory[(I + i) & 0xFFF] << 56;
+        uint64_t bits;
+        if constexpr (platform::wrapping)
+            bits = sprite >> x_coor | sprite << ((64 - x_coor) & 63);
+        else
+            bits = sprite >> x_coor;
+
+        collision |= display[y_coor] & bits;
+        display[y_coor] ^= bits;
+        dirty_rows |= 1u << y_coor;
+
+        y_coor++;
+        if constexpr (platform::wrapping)
+            y_coor %= 32;
+        else if (y_coor > 31)
+            break;
+    }
+    V[0xF] = collision != 0;
+}
+
+void chip8_core::equal_skip(const micro_op& op)
+{
+	if (V[op.x] == op.nn)
+	{
+		PC += 2;
+	}
+}
+
+void chip8_core::unequal_skip(const micro_op& op)
+{
+	if (V[op.x] != op.nn)
+	{
+		PC += 2;
+	}
+}
+
+void chip8_core::equal_register_skip(const micro_op& op)
+{
+	if (V[op.x] == V[op.y])
+	{
+		PC += 2;
+	}
+}
+
+void chip8_core::unequal_register_skip(const micro_op& op)
+{
+	if (V[op.x] != V[op.y])
+	{
+		PC += 2;
+	}
+}
+
+void chip8_core::logical_set(const micro_op& op)
+{
+	V[op.x] = V[op.y];
+}
+
+template <typename platform>
+void chip8_core::logical_OR(const micro_op& op)
+{
+	V[op.x] |= V[op.y];
+    if constexpr (platform::logic)
+        V[0x0F] = 0;
+}
+
+template <typename platform>
+void chip8_core::logical_AND(const micro_op& op)
+{
+	V[op.x] &= V[op.y];
+    if constexpr (platform::logic)
+	    V[0x0F] = 0;
+}
+
+template <typename platform>
+void chip8_core::logical_XOR(const micro_op& op)
+{
+	V[op.x] ^= V[op.y];
+    if constexpr (platform::logic)
+	    V[0x0F] = 0;
+}
+
+void chip8_core::logical_add(const micro_op& op)
+{
+	uint8_t temp = V[op.x];
+	if ((V[op.x] + V[op.y]) > 255)
+		temp = 1;
+	else
+		temp = 0;
+
+	V[op.x] += V[op.y];
+	V[0xF] = temp;
+	
+}
+
+void chip8_core::logical_subtract(const micro_op& op)
+{
+	uint8_t temp;
+	if (V[op.x] >= V[op.y])
+		temp = 1;
+	else
+		temp = 0;
+
+	V[op.x] -= V[op.y];
+	V[0xF] = temp;
+}
+
+void chip8_core::logical_subtract_reverse(const micro_op& op)
+{
+	uint8_t temp;
+	if (V[op.y] >= V[op.x])
+		temp = 1;
+	else
+		temp = 0;
+
+	V[op.x] = V[op.y] - V[op.x];
+	V[0xF] = temp;
+}
+
+template <typename platform>
+void chip8_core::shift_right(const micro_op& op)
+{
+    if constexpr (!platform::shifting)
+	    V[op.x] = V[op.y];
+	uint8_t bit = V[op.x] & 0x01;
+	V[op.x] = V[op.x] >> 1;
+	V[0xF] = bit;
+}
+
+template <typename platform>
+void chip8_core::shift_left(const micro_op& op)
+{
+    if constexpr (!platform::shifting)
+	    V[op.x] = V[op.y];
+	uint8_t bit = (V[op.x] & 0x80) >> 7;
+	V[op.x] = V[op.x] << 1;
+	V[0xF] = bit;
+}
+
+template <typename platform>
+void chip8_core::offset_jump(const micro_op& op)
+{
+    if constexpr (platform::jumping)
+        PC = op.nnn + V[op.x];
+    else
+	    PC = op.nnn + V[0];
+}
+
+void chip8_core::random(const micro_op& op)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+	uint8_t random = (random_state >> 24) & op.nn;
+	V[op.x] = random;
+}
+
+void chip8_core::get_delay_timer(const micro_op& op)
+{
+	V[op.x] = DT;
+}
+
+void chip8_core::set_delay_timer(const micro_op& op)
+{
+	DT = V[op.x];
+}
+
+void chip8_core::set_sound_timer(const micro_op& op)
+{
+	ST = V[op.x];
+}
+
+void chip8_core::add_index(const micro_op& op)
+{
+	I += V[op.x];
+	if (I >= 0x1000)
+		V[0xF] = 1;
+}
+
+void chip8_core::point_font(const micro_op& op)
+{
+	I = 0x50 + (5 * (V[op.x] & 0xF));
+}
+
+void chip8_core::decimal_conversion(const micro_op& op)
+{
+    // I can point past 0xFFF after FX1E, so every access wraps like the fetch does
+	memory[I & 0xFFF] = V[op.x] / 100;
+	memory[(I + 1) & 0xFFF] = (V[op.x] / 10) % 10;
+	memory[(I + 2) & 0xFFF] = V[op.x] % 10;
+    invalidate(I);
+    invalidate(I + 1);
+    invalidate(I + 2);
+
+}
+
+template <typename platform>
+void chip8_core::store_memory(const micro_op& op)
+{
+	for (uint8_t i = 0; i <= op.x; i++)
+	{
+		memory[(I + i) & 0xFFF] = V[i];
+        invalidate(I + i);
+	}
+
+    if constexpr (platform::memory)
+        I += op.x + 1;
+}
+
+template <typename platform>
+void chip8_core::load_memory(const micro_op& op)
+{
+	for (uint8_t i = 0; i <= op.x; i++)
+	{
+		V[i] = memory[(I + i) & 0xFFF];
+	}
+
+    if constexpr (platform::memory)
+        I += op.x + 1;
+}
+
+void chip8_core::skip_if_key(const micro_op& op)
+{
+    // Only the low nibble of VX selects a key
+	if (keypad[V[op.x] & 0xF] == true)
+	{
+		PC += 2;
+	}
+}
+
+void chip8_core::skip_if_not_key(const micro_op& op)
+{
+	if (keypad[V[op.x] & 0xF] == false)
+	{
+		PC += 2;
+	}
+}
+
+void chip8_core::get_key(const micro_op& op)
+{
+    key_register = op.x;
+    halted = true;
+    poll_key();
+    if (halted)
+        frame_wait = true;
+}
+
+void chip8_core::poll_key()
+{
+    // Wakes once the last pressed key is released
+	int8_t key_pressed = -1;
+    for (uint8_t i = 0; i <= 0x0F; i++)
+    {
+        if (keypad[i] == true)
+        {
+            key_pressed = i;
+            break;
+        }
+    }
+
+    if (pressed_key > -1 && keypad[pressed_key] == false)
+    {
+        V[key_register] = pressed_key;
+        pressed_key = -1;
+        halted = false;
+    }
+
+    if (key_pressed > -1) pressed_key = key_pressed;
+}
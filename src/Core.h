@@ -0,0 +1,345 @@
+#ifndef CORE_H
+#define CORE_H
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Jit.h"
+
+// CHIP-8 machine without any window, audio or config code, so it builds anywhere
+class chip8_core
+{
+public:
+    // Platform quirks, each interpreter handler is compiled once per profile
+    struct quirks
+    {
+        bool logic;        // 8XY1/8XY2/8XY3 reset VF
+        bool wrapping;     // Sprites wrap around the screen edges
+        bool display_wait; // DXYN waits for the start of the next frame
+        bool shifting;     // 8XY6/8XYE shift VX in place instead of copying VY
+        bool memory;       // FX55/FX65 increment I
+        bool jumping;      // BNNN jumps to XNN + VX instead of NNN + V0
+    };
+    template <bool L, bool W, bool D, bool S, bool M, bool J>
+    struct quirk_profile
+    {
+        static constexpr bool logic = L;
+        static constexpr bool wrapping = W;
+        static constexpr bool display_wait = D;
+        static constexpr bool shifting = S;
+        static constexpr bool memory = M;
+        static constexpr bool jumping = J;
+        static constexpr quirks value = { L, W, D, S, M, J };
+    };
+    typedef quirk_profile<true, false, true, false, true, false> cosmac_vip;
+    typedef quirk_profile<false, false, false, true, true, true> chip48;
+    typedef quirk_profile<false, false, false, true, false, true> schip;
+    typedef quirk_profile<false, true, false, false, true, false> modern;
+
+    // Configs from before profiles only had the logic, wrapping and display wait switches,
+    // the other quirks were fixed
+    template <bool L, bool W, bool D>
+    using legacy = quirk_profile<L, W, D, false, true, false>;
+
+    enum profile : uint8_t
+    {
+        profile_cosmac_vip, profile_chip48, profile_schip, profile_modern,
+        profile_legacy, // Eight legacy profiles follow, see legacy_profile
+        profile_count = profile_legacy + 8
+    };
+    static const char* profile_names[profile_count];
+    static const quirks profile_quirks[profile_count];
+    static uint8_t find_profile(const std::string& name);
+    static uint8_t legacy_profile(bool logic, bool wrapping, bool display_wait);
+
+    typedef uint64_t frame[32]; // 32 rows of 64 pixels, bit 63 of a row is x = 0
+    static const uint8_t font[80]; // Stored at 0x50 to 0x9F
+
+    // Complete machine state, restored with plain copies and without reloading the ROM
+    struct state
+    {
+        uint8_t memory[4096];
+        uint8_t V[16];
+        uint16_t I;
+        uint16_t PC;
+        uint8_t SP;
+        uint16_t stack[16];
+        uint8_t DT;
+        uint8_t ST;
+        bool keypad[16];
+        uint64_t display[32];
+        bool sound;
+        int8_t pressed_key;
+        bool halted;
+        uint8_t key_register;
+        uint32_t loop_index;
+        uint32_t IPF;
+        uint32_t speed_remainder;
+        double cycle_budget;
+        uint32_t random_state;
+        uint64_t instruction_count;
+    };
+    static const uint16_t state_version = 1;
+
+    chip8_core();
+    ~chip8_core();
+    chip8_core(const chip8_core&) = delete;
+    chip8_core& operator=(const chip8_core&) = delete;
+
+    // Setup
+    void select_profile(uint8_t profile);
+    bool load(const std::string& game);
+    bool load(const uint8_t* data, size_t size);
+    void reset();
+    bool enable_jit();
+    void disable_jit();
+    void set_speed(uint32_t ips);
+    void set_timing(uint8_t model);
+    void seed(uint32_t value);
+
+    // Save states, in memory or as a versioned file tied to the loaded ROM
+    void save_state(state& snapshot) const;
+    void load_state(const state& snapshot);
+    bool save_state(const std::string& path) const;
+    bool load_state(const std::string& path);
+    void serialize(const state& snapshot, std::vector<uint8_t>& data) const;
+    bool deserialize(const std::vector<uint8_t>& data, state& snapshot) const;
+
+    // Runs one instruction, ending the frame once its budget is used
+    void step();
+    // Runs the rest of the frame's instructions and ticks the timers
+    void run_frame();
+
+    void set_keys(uint16_t keys);
+    const frame& framebuffer() const { return display; }
+    bool pixel(uint8_t x, uint8_t y) const { return (display[y & 31] >> (63 - (x & 63))) & 1; }
+    uint64_t framebuffer_hash() const;
+    uint64_t rom_hash() const;
+
+    uint8_t memory[4096]; // 4096 bytes or 4 kilobytes of memory
+    uint8_t selected_profile; // Last profile passed to select_profile
+    uint32_t IPS; // Instructions per second
+    uint32_t IPF; // Instructions in the current frame
+    uint32_t speed_remainder; // Instructions per second left over after whole frames
+    uint64_t instruction_count; // Instruction slots run since the ROM was loaded
+
+    // Frames either run a flat IPF or charge every instruction its COSMAC VIP machine cycles
+    enum timing_model : uint8_t
+    {
+        timing_flat, timing_vip
+    };
+    uint8_t timing;
+    double cycle_budget; // Machine cycles left in this frame, an overrun is taken from the next one
+
+    // CXNN draws from a per-instance xorshift generator, restarted from the seed on load and reset
+    uint32_t random_seed;
+    uint32_t random_state;
+
+    // Registers
+    uint8_t V[16];
+    uint16_t I;
+    uint8_t DT; // Delay Timer
+    uint8_t ST; // Sound timer
+    uint16_t PC; // Program Counter
+    uint8_t SP; // Stack Pointer
+    uint16_t stack[16]; // Stack, SP wraps around instead of overflowing
+    uint32_t stack_faults; // Calls past a full stack and returns from an empty one
+    bool keypad[16]; // Key inputs
+
+    // Display
+    uint64_t display[32]; // 64x32 display, a row per word with bit 63 as x = 0
+    uint32_t dirty_rows; // Rows drawn or cleared since the frontend last cleared this, bit N is row N
+    bool sound; // Sound timer was running during the last frame
+
+    uint32_t loop_index;
+    int8_t pressed_key;
+
+    // FX0A halts the CPU until a key is pressed and released
+    bool halted;
+    uint8_t key_register;         // Register FX0A stores the key in
+    uint64_t halted_instructions; // Instruction slots skipped while halted
+
+    // Predecoded instruction with its handler and operands extracted
+    struct micro_op;
+    typedef void (chip8_core::*opcode_handler)(const micro_op& op);
+    struct micro_op
+    {
+        opcode_handler handler;
+        uint16_t opcode;
+        uint16_t nnn;
+        uint8_t x;
+        uint8_t y;
+        uint8_t n;
+        uint8_t nn;
+    };
+    micro_op decoded[4096]; // Predecoded instruction cache indexed by address
+
+    // Handler index for every opcode
+    enum operation : uint8_t
+    {
+        op_trap, op_clear_screen, op_return_from_subroutine, op_jump, op_call_subroutine,
+        op_equal_skip, op_unequal_skip, op_equal_register_skip, op_set_vx, op_add_vx,
+        op_logical_set, op_logical_OR, op_logical_AND, op_logical_XOR, op_logical_add,
+        op_logical_subtract, op_shift_right, op_logical_subtract_reverse, op_shift_left,
+        op_unequal_register_skip, op_set_index, op_offset_jump, op_random, op_draw,
+        op_skip_if_key, op_skip_if_not_key, op_get_delay_timer, op_set_delay_timer,
+        op_set_sound_timer, op_point_font, op_decimal_conversion, op_store_memory,
+        op_load_memory, op_add_index, op_get_key, op_count
+    };
+
+    // Superinstructions for common sequences, recognized when the ROM is loaded
+    enum fusion : uint8_t
+    {
+        fusion_set_index_draw,  // ANNN DXYN
+        fusion_wait_delay,      // FX07 3X00 1NNN back to FX07
+        fusion_set_vx_pair,     // 6XNN 6YNN
+        fusion_add_carry_skip,  // 8XY4 3F01
+        fusion_self_jump,       // 1NNN to itself
+        fusion_count
+    };
+    struct fused_op;
+    typedef uint32_t (chip8_core::*fused_handler)(const fused_op& op, uint32_t budget);
+    struct fused_op
+    {
+        fused_handler handler; // Returns the instructions it executed
+        uint8_t kind;
+        uint8_t length;        // Most instructions it can execute
+        micro_op first;
+        micro_op second;
+    };
+    fused_op fused[4096];
+    uint64_t fused_count[fusion_count]; // Fused ops executed
+    uint64_t fused_instructions;        // Instructions covered by fused ops
+    uint64_t idle_instructions;         // Instructions skipped in idle loops
+    bool frame_wait;                    // Set by an instruction that can only repeat until the next frame
+
+    // Optional x86-64 recompiler, the interpreter is used when it is off or unavailable
+    jit* recompiler = nullptr;
+
+#ifdef CHIP8_PROFILER
+    // Execution profile since the ROM was loaded. Superinstructions and the JIT are
+    // off in profiler builds, so every instruction is counted at its own address.
+    struct profile_data
+    {
+        uint64_t operations[op_count]; // Instructions run per opcode class
+        uint64_t addresses[4096];      // Instructions run per address
+        uint64_t draw_ns;              // Time spent inside DXYN
+    } profile;
+    static const char* operation_names[op_count];
+    void clear_profile();
+#endif
+
+    // Unknown opcodes
+    uint32_t trap_count;
+    uint16_t trapped_opcode;
+
+    // Counters about the run rather than the machine, which load_state leaves alone.
+    // Run-ahead copies them so its speculative frames are not counted.
+    struct statistics
+    {
+        uint32_t stack_faults;
+        uint64_t halted_instructions;
+        uint64_t fused_count[fusion_count];
+        uint64_t fused_instructions;
+        uint64_t idle_instructions;
+        uint32_t trap_count;
+        uint16_t trapped_opcode;
+#ifdef CHIP8_PROFILER
+        profile_data profile;
+#endif
+    };
+    void save_statistics(statistics& snapshot) const;
+    void load_statistics(const statistics& snapshot);
+
+private:
+    friend class jit;
+    friend struct dispatch_benchmark;
+    friend struct rom_benchmark;
+    friend class chip8_vector;
+    friend class profile_report;
+
+    static constexpr uint8_t classify(uint16_t opcode);
+    static constexpr std::array<uint8_t, 0x10000> build_dispatch_table();
+    static const std::array<uint8_t, 0x10000> dispatch_table; // Generated at compile time
+    template <typename platform> static const opcode_handler handlers[op_count];
+    template <typename platform> static const fused_handler fused_handlers[fusion_count];
+    const opcode_handler* active_handlers;
+    const fused_handler* active_fused;
+    const quirks* active_quirks;
+    template <typename platform> void use_profile();
+
+    std::vector<uint8_t> rom; // Kept for reset
+
+    // COSMAC VIP timing
+    static const double vip_frame_cycles;
+    static const uint16_t vip_cycles[op_count];
+    uint32_t vip_cost(uint16_t opcode, uint8_t operation) const;
+    void execute_vip();
+
+    void end_frame();
+    void next_budget();
+    uint8_t read(uint16_t program_counter);
+    uint16_t fetch(uint16_t& program_counter);
+    void decode(uint16_t instruction);
+    micro_op predecode(uint16_t opcode);
+    uint32_t execute(uint32_t budget);
+    static void jit_call(chip8_core* emulator, const micro_op* op);
+    void invalidate(uint16_t address);
+    void flush_decoded();
+    void fuse(uint16_t address);
+    void fuse_all();
+    void clear_fusion_counts();
+    bool idle_loop(uint16_t address) const;
+#ifdef CHIP8_PROFILER
+    void profile_instruction(uint16_t address, const micro_op& op);
+#endif
+
+    // Superinstructions
+    template <typename platform> uint32_t set_index_draw(const fused_op& op, uint32_t budget);
+    uint32_t wait_delay(const fused_op& op, uint32_t budget);
+    uint32_t set_vx_pair(const fused_op& op, uint32_t budget);
+    uint32_t add_carry_skip(const fused_op& op, uint32_t budget);
+    uint32_t self_jump(const fused_op& op, uint32_t budget);
+
+    // Opcodes
+    void trap(const micro_op& op);
+    void clear_screen(const micro_op& op);
+    void jump(const micro_op& op);
+    void call_subroutine(const micro_op& op);
+    void return_from_subroutine(const micro_op& op);
+    void set_vx(const micro_op& op);
+    void add_vx(const micro_op& op);
+    void set_index(const micro_op& op);
+    template <typename platform> void draw(const micro_op& op);
+    void equal_skip(const micro_op& op);
+    void unequal_skip(const micro_op& op);
+    void equal_register_skip(const micro_op& op);
+    void unequal_register_skip(const micro_op& op);
+    void logical_set(const micro_op& op);
+    template <typename platform> void logical_OR(const micro_op& op);
+    template <typename platform> void logical_AND(const micro_op& op);
+    template <typename platform> void logical_XOR(const micro_op& op);
+    void logical_add(const micro_op& op);
+    void logical_subtract(const micro_op& op);
+    void logical_subtract_reverse(const micro_op& op);
+    template <typename platform> void shift_right(const micro_op& op);
+    template <typename platform> void shift_left(const micro_op& op);
+    template <typename platform> void offset_jump(const micro_op& op);
+    void random(const micro_op& op);
+    void get_delay_timer(const micro_op& op);
+    void set_delay_timer(const micro_op& op);
+    void set_sound_timer(const micro_op& op);
+    void add_index(const micro_op& op);
+    void point_font(const micro_op& op);
+    void decimal_conversion(const micro_op& op);
+    template <typename platform> void store_memory(const micro_op& op);
+    template <typename platform> void load_memory(const micro_op& op);
+    void skip_if_key(const micro_op& op);
+    void skip_if_not_key(const micro_op& op);
+    void get_key(const micro_op& op);
+    void poll_key();
+};
+
+#endif
@@ -1,6 +1,10 @@
 #include <iostream>
 #include "Emulator.h"
+#include "Profiler.h"
 #include <SDL.h>
+#include "imgui.h"
+#include "imgui_impl_sdl2.h"
+#include "imgui_impl_sdlrenderer2.h"
 
 int chip8::emulate(std::string game, std::string config_path)
 {
@@ -15,11 +19,16 @@ int chip8::emulate(std::string game, std::string config_path)
         config_file.close();
 
         settings.volume = config["volume"];
-        settings.display_wait = config["display_wait"];
         IPS = config["IPS"];
         settings.fullscreen = config["start_games_fullscreen"];
-        settings.wrapping = config["wrapping"];
-        settings.logic = config["logic"];
+        settings.jit = config.value("jit", false);
+        settings.vip_timing = config.value("vip_timing", false);
+        settings.run_ahead = config.value("run_ahead", 0);
+        if (settings.run_ahead < 0) settings.run_ahead = 0;
+        settings.seed = config.value("seed", 1u);
+        settings.fast_forward = config.value("fast_forward_speed", 4);
+        if (settings.fast_forward < 1) settings.fast_forward = 1;
+        settings.profile = profile_from_config(config);
 
         pixel_on_R = config["pixel_on_color_R"];
         pixel_on_G = config["pixel_on_color_G"];
@@ -39,17 +48,59 @@ int chip8::emulate(std::string game, std::string config_path)
 	SDL_Renderer* renderer = nullptr;
 	if (!init_sdl(window, renderer, game, config_path)) return 1;
     if (!init_audio(settings)) return 1;
-    if (!init_chip8(game))
+    select_profile(settings.profile);
+    seed(settings.seed);
+    if (!load(game))
     {
         return 1;
     }
 
+    // The launcher reuses this object, so slots and history from the last game are dropped
+    for (uint8_t i = 0; i < slot_count; i++)
+    {
+        slot_saved[i] = false;
+    }
+    history.clear();
+    rewinding = false;
+    recording = false;
+    fast_forward = false;
+
     if (settings.fullscreen)
         SDL_SetWindowFullscreen(window,
         SDL_WINDOW_FULLSCREEN_DESKTOP);
 
     // Determine Instructions per frame
-    IPF = IPS / 60;
+    set_speed(IPS);
+    set_timing(settings.vip_timing ? timing_vip : timing_flat);
+
+    if (settings.jit && !enable_jit())
+        SDL_Log("JIT recompiler unavailable, using the interpreter");
+
+    // Turbo mode shows the achieved speed in the title. Idle and halted slots are skipped
+    // without running anything, so only executed instructions count. A loaded state can
+    // take the slot count below the skipped ones, hence signed.
+    const std::string window_title = SDL_GetWindowTitle(window);
+    auto executed_count = [this]() { return (int64_t)(instruction_count - idle_instructions - halted_instructions); };
+    uint64_t report_time = SDL_GetPerformanceCounter();
+    int64_t report_count = executed_count();
+
+    // Run-ahead cost against the frames it hides the latency of
+    uint64_t frame_ticks = 0;
+    uint64_t run_ahead_ticks = 0;
+    uint64_t run_ahead_frames = 0;
+
+    // Frames are paced against a running deadline. A frame that finishes after it is
+    // not drawn, so the next one can catch up, but no more than max_skipped in a row.
+    const uint64_t host_frame = SDL_GetPerformanceFrequency() / 60;
+    const uint32_t max_skipped = 4;
+    uint64_t deadline = SDL_GetPerformanceCounter() + host_frame;
+    uint32_t skipped_in_a_row = 0;
+    late_frames = 0;
+
+    // Per frame costs summed over the current second, shown averaged by the overlay
+    const double ticks_per_us = SDL_GetPerformanceFrequency() / 1000000.0;
+    hud = {};
+    hud_stats sums = {};
 
     running = true;
 	// Main emulator loop
@@ -58,56 +109,223 @@ int chip8::emulate(std::string game, std::string config_path)
 		handle_input(window, settings, game);
 
 		if (paused)
+        {
+            deadline = SDL_GetPerformanceCounter() + host_frame;
 			continue;
+        }
 
 		const uint64_t start_frame_time = SDL_GetPerformanceCounter();
-		// Execute opcodes 
-		for (loop_index = 0; loop_index < IPF; loop_index++)
-		{
-			uint16_t opcode = fetch(PC);
-			decode(opcode);
-		}
+        if (rewinding)
+        {
+            // Steps back one recorded frame per host frame, stopping at the oldest
+            history.rewind(*this);
+        }
+        else if (turbo)
+        {
+            // Runs emulated frames back to back until a host frame has passed.
+            // Timers still tick once per emulated frame.
+            do
+            {
+                run_emulated_frame();
+            } while (SDL_GetPerformanceCounter() - start_frame_time < host_frame);
+        }
+        else if (fast_forward)
+        {
+            // Whole frames, so the timers speed up with the game, and only the last one is shown
+            for (int i = 0; i < settings.fast_forward; i++)
+            {
+                run_emulated_frame();
+            }
+        }
+        else
+        {
+            // Execute opcodes and update timers
+            run_emulated_frame();
+        }
 		const uint64_t end_frame_time = SDL_GetPerformanceCounter();
 
-		// Gets the time it took to execute the opcodes
-		const double time_elapsed = (double)((end_frame_time - start_frame_time) / 1000) / SDL_GetPerformanceFrequency();
+        // The rewind history takes one snapshot per host frame, so fast-forward keeps only
+        // the frame it shows. Turbo is not recorded, as a snapshot costs about a hundred
+        // emulated frames and would decide the speed turbo reaches.
+        if (!rewinding && !turbo)
+            history.record(*this);
 
-		// Draws the screen
-		for (uint8_t y = 0; y < 32; y++)
-		{
-			for (uint8_t x = 0; x < 64; x++)
-			{
-				if (display[x][y] == true)
-				{
-					SDL_SetRenderDrawColor(renderer, pixel_on_R, pixel_on_G, pixel_on_B, 255);
-					SDL_RenderDrawPoint(renderer, x, y);
-				}
-				else
-				{
-					SDL_SetRenderDrawColor(renderer, pixel_off_R, pixel_off_G, pixel_off_B, 255);
-					SDL_RenderDrawPoint(renderer, x, y);
-				}
-			}
-		}
+        sums.emulate_us += (end_frame_time - start_frame_time) / ticks_per_us;
+        sums.frames++;
 
-		// Update timers
-		if (ST > 0)
-		{
-			ST--;
-			SDL_PauseAudioDevice(dev, 0);
-		}
-		else
-			SDL_PauseAudioDevice(dev, 1);
-		if (DT > 0) DT--;
+        if (end_frame_time - report_time >= SDL_GetPerformanceFrequency())
+        {
+            // Rewinding runs the instruction count backwards
+            const double seconds = (double)(end_frame_time - report_time) / SDL_GetPerformanceFrequency();
+            const int64_t count = executed_count();
+            const double executed = count > report_count ? (double)(count - report_count) : 0.0;
+            const double mips = executed / seconds / 1000000.0;
+            if (turbo)
+            {
+                char title[256];
+                snprintf(title, sizeof(title), "%s - Turbo %.2f MIPS", window_title.c_str(), mips);
+                SDL_SetWindowTitle(window, title);
+            }
+            else
+                SDL_SetWindowTitle(window, window_title.c_str());
+            report_time = end_frame_time;
+            report_count = count;
+
+            hud.achieved_ips = executed / seconds;
+            hud.frames = sums.frames;
+            hud.shown = sums.shown;
+            hud.late = sums.late;
+            hud.unchanged = sums.unchanged;
+            hud.emulate_us = sums.emulate_us / sums.frames;
+            hud.draw_us = sums.shown > 0 ? sums.draw_us / sums.shown : 0;
+            hud.present_us = sums.shown > 0 ? sums.present_us / sums.shown : 0;
+            hud.sleep_ms = sums.sleep_ms / sums.frames;
+            sums = {};
+        }
+
+        // Turbo already takes a whole host frame, so it is never late
+        const bool late = !turbo && end_frame_time > deadline;
+        const bool draw = !late || skipped_in_a_row >= max_skipped;
+        if (draw)
+        {
+            skipped_in_a_row = 0;
+        }
+        else
+        {
+            skipped_in_a_row++;
+            late_frames++;
+            sums.late++;
+        }
+
+        // Shows where the game will be N frames from now with the keys held right now,
+        // then goes back to the real frame after drawing, so a key press shows up N frames sooner
+        const bool run_ahead = draw && settings.run_ahead > 0 && !turbo && !fast_forward && !rewinding;
+        if (run_ahead)
+        {
+            const uint64_t start_ahead_time = SDL_GetPerformanceCounter();
+            save_state(run_ahead_state);
+            save_statistics(run_ahead_statistics);
+            for (int i = 0; i < settings.run_ahead; i++)
+            {
+                run_frame();
+            }
+            run_ahead_ticks += SDL_GetPerformanceCounter() - start_ahead_time;
+        }
+
+        // Draws the screen, unless the frame is late. A frame that changed no rows leaves
+        // the last one on the window and skips the present as well.
+        const bool changed = dirty_rows != 0 || redraw || show_hud;
+        if (draw && changed)
+        {
+            const uint64_t start_draw_time = SDL_GetPerformanceCounter();
+            upload_screen();
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            SDL_RenderCopy(renderer, screen, nullptr, nullptr);
+            sums.draw_us += (SDL_GetPerformanceCounter() - start_draw_time) / ticks_per_us;
+
+            if (show_hud)
+                draw_hud(window, renderer);
+        }
+
+        if (run_ahead)
+        {
+            const uint64_t start_restore_time = SDL_GetPerformanceCounter();
+            load_state(run_ahead_state);
+            load_statistics(run_ahead_statistics);
+            run_ahead_ticks += SDL_GetPerformanceCounter() - start_restore_time;
+            frame_ticks += end_frame_time - start_frame_time;
+            run_ahead_frames++;
+        }
 
-		SDL_RenderPresent(renderer);
+		// Beeps while the sound timer is running
+		SDL_PauseAudioDevice(dev, sound ? 0 : 1);
 
-		// Delay every 16.67ms to keep the emulator running at 60fps
-		uint32_t delay = 16.67f > time_elapsed ? 16.67f - time_elapsed : 0;
-		SDL_Delay(delay);
+        if (draw && changed)
+        {
+            const uint64_t start_present_time = SDL_GetPerformanceCounter();
+            SDL_RenderPresent(renderer);
+            sums.present_us += (SDL_GetPerformanceCounter() - start_present_time) / ticks_per_us;
+            sums.shown++;
+            redraw = false;
+        }
+        else if (draw)
+            sums.unchanged++;
+
+        // Sleeps until the deadline to keep the emulator running at 60fps. After a long
+        // stall the deadline restarts from now instead of racing to catch up.
+        const uint64_t now = SDL_GetPerformanceCounter();
+        if (turbo || now > deadline + max_skipped * host_frame)
+            deadline = now;
+        else if (now < deadline)
+        {
+            const uint32_t delay = (uint32_t)((deadline - now) * 1000 / SDL_GetPerformanceFrequency());
+            sums.sleep_ms += delay;
+            SDL_Delay(delay);
+        }
+        deadline += host_frame;
 	}
 
+    if (recording)
+        stop_movie(game);
+
+    if (trap_count > 0)
+        SDL_Log("Trapped %u unknown opcodes, last was %04X", trap_count, trapped_opcode);
+    if (stack_faults > 0)
+        SDL_Log("Stack overflowed or underflowed %u times", stack_faults);
+
+    // Reports how many dispatches the superinstructions saved for this ROM
+    const char* fusion_names[fusion_count] = { "ANNN+DXYN", "FX07+3X00+1NNN", "6XNN+6YNN", "8XY4+3F01", "1NNN self jump" };
+    uint64_t fused_total = 0;
+    for (uint8_t i = 0; i < fusion_count; i++)
+    {
+        if (fused_count[i] > 0)
+            SDL_Log("Fused %s executed %llu times", fusion_names[i], (unsigned long long)fused_count[i]);
+        fused_total += fused_count[i];
+    }
+    if (fused_total > 0)
+        SDL_Log("Fused ops executed: %llu, dispatches saved: %llu",
+            (unsigned long long)fused_total, (unsigned long long)(fused_instructions - fused_total));
+    if (idle_instructions > 0)
+        SDL_Log("Idle loops fast-forwarded: %llu instructions", (unsigned long long)idle_instructions);
+    if (halted_instructions > 0)
+        SDL_Log("Waiting for keys saved %llu instructions", (unsigned long long)halted_instructions);
+
+    if (run_ahead_frames > 0)
+    {
+        const double frame_us = (double)frame_ticks * 1000000.0 / SDL_GetPerformanceFrequency() / run_ahead_frames;
+        const double run_ahead_us = (double)run_ahead_ticks * 1000000.0 / SDL_GetPerformanceFrequency() / run_ahead_frames;
+        SDL_Log("Run-ahead of %d frames: %.1f us per frame, %.2f%% of a 60 Hz frame, on top of %.1f us for the real frame",
+            settings.run_ahead, run_ahead_us, run_ahead_us / 16667.0 * 100.0, frame_us);
+    }
+
+    if (late_frames > 0)
+        SDL_Log("Skipped drawing %llu late frames", (unsigned long long)late_frames);
+
+#ifdef CHIP8_PROFILER
+    // BRIX.ch8 writes its profile to BRIX.profile.json
+    std::filesystem::path profile_path = game;
+    profile_path.replace_extension(".profile.json");
+    if (profile_report(*this).save(profile_path.string(), game))
+        SDL_Log("Wrote the execution profile to %s", profile_path.string().c_str());
+#endif
+
+    // Reports what the rewind history cost
+    if (history.encoded_frames > 0)
+    {
+        SDL_Log("Rewind history: %zu frames (%.1f s) in %zu KB, %.1f bytes per frame, %zu KB allocated",
+            history.frames(), history.frames() / 60.0, history.bytes_used() / 1024,
+            history.frames() > 0 ? (double)history.bytes_used() / history.frames() : 0.0, history.memory_used() / 1024);
+        SDL_Log("Rewind history: %.2f us per recorded frame", history.encode_ns / 1000.0 / history.encoded_frames);
+    }
+    if (history.restored_frames > 0)
+        SDL_Log("Rewind history: %.2f us per rewound frame", history.restore_ns / 1000.0 / history.restored_frames);
+
     // Cleanup
+    disable_jit();
+    destroy_hud();
+    SDL_DestroyTexture(screen);
+    screen = nullptr;
     SDL_DestroyWindow(window);
     SDL_DestroyRenderer(renderer);
     SDL_CloseAudioDevice(dev);
@@ -148,6 +366,16 @@ bool chip8::init_sdl(SDL_Window*& window, SDL_Renderer*& renderer, std::string g
         SDL_FreeSurface(icon_surface);
     }
 
+    screen = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 64, 32);
+    if (!screen)
+    {
+        SDL_Log("Unable to create SDL texture: %s", SDL_GetError());
+        return false;
+    }
+    palette[0] = 0xFF000000 | pixel_off_R << 16 | pixel_off_G << 8 | pixel_off_B;
+    palette[1] = 0xFF000000 | pixel_on_R << 16 | pixel_on_G << 8 | pixel_on_B;
+    redraw = true;
+
 	SDL_RenderSetLogicalSize(renderer, 64, 32);
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
@@ -183,96 +411,6 @@ bool chip8::init_audio(config config)
 	return true;
 }
 
-bool chip8::init_chip8(std::string game)
-{
-    // Initialize 4KB memory
-    for (uint16_t i = 0; i < 4096; i++)
-    {
-        memory[i] = 0;
-    }
-
-	// Default font for the chip-8
-	uint8_t font[80] = {
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-	};
-
-	// Initialize font
-	// Stored at 0x50 to 0x9F
-	for (uint8_t i = 0; i < 80; i++)
-	{
-		memory[i + 0x50] = font[i];
-	}
-
-	// Load rom into memory
-	std::ifstream ifs;
-	ifs.open(game, std::ifstream::binary);
-	if (!ifs.is_open())
-	{
-		return false;
-	}
-
-	ifs.seekg(0, std::ios::end);
-	std::streampos file_size = ifs.tellg();
-	ifs.seekg(0, std::ios::beg);
-	ifs.read(reinterpret_cast<char*>(memory + 0x200), file_size);
-    ifs.close();
-
-    // Initialize sound timer and delay timer
-    ST = 0;
-    DT = 0;
-
-    // Initialize registers
-    SP = 0;
-    I = 0;
-    for (uint8_t i = 0; i < 16; i++)
-    {
-        V[i] = 0;
-    }
-
-    // Initialize keypad
-    for (uint8_t i = 0; i < 16; i++)
-    {
-        keypad[i] = false;
-    }
-
-    // Initialize display array
-    for (uint8_t x = 0; x < 64; x++)
-    {
-        for (uint8_t y = 0; y < 32; y++)
-        {
-            display[x][y] = false;
-        }
-    }
-
-    // Initialize variables
-    pressed_key = -1;
-
-    // Initialize stack
-    while (!stack.empty())
-    {
-        stack.pop();
-    }
-
-	// Point Program counter to start of memory
-	PC = 0x200;
-    return true;
-}
-
 void chip8::audio_callback(void *userdata, uint8_t *stream, int len)
 {
     chip8* instance = static_cast<chip8*>(userdata);
@@ -307,6 +445,10 @@ void chip8::handle_input(SDL_Window*& window, config& config, std::string game)
                     running = false;
                     return;
                 }
+
+                // The window's contents are lost, so the next frame is presented even if nothing changed
+                if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    redraw = true;
                 break;
 
 			case SDL_KEYDOWN:
@@ -340,9 +482,61 @@ void chip8::handle_input(SDL_Window*& window, config& config, std::string game)
 						else paused = true;
 						break;
 
+                    // Shows or hides the performance overlay
+                    case SDLK_F7:
+                        show_hud = !show_hud;
+                        redraw = true;
+                        break;
+
+                    // Runs as fast as the host allows
+                    case SDLK_F6:
+                        turbo = !turbo;
+                        break;
+
+                    // Loads a save state slot, or saves it with Shift held
+                    case SDLK_F1:
+                    case SDLK_F2:
+                    case SDLK_F3:
+                    case SDLK_F4:
+                    {
+                        uint8_t slot = (uint8_t)(event.key.keysym.sym - SDLK_F1);
+                        if (event.key.keysym.mod & KMOD_SHIFT)
+                            save_slot(slot, game);
+                        else
+                        {
+                            // A movie only holds keys, so it ends before the machine jumps elsewhere
+                            if (recording)
+                                stop_movie(game);
+                            load_slot(slot, game);
+                        }
+                        break;
+                    }
+
+                    // Starts or stops recording a movie
+                    case SDLK_F9:
+                        if (recording)
+                            stop_movie(game);
+                        else
+                            start_movie(game);
+                        break;
+
+                    // Runs several frames per host frame while held
+                    case SDLK_TAB:
+                        fast_forward = true;
+                        break;
+
+                    // Plays recorded frames backwards while held
+                    case SDLK_BACKSPACE:
+                        if (recording)
+                            stop_movie(game);
+                        rewinding = true;
+                        break;
+
                     // Restarts the loaded ROM
                     case SDLK_t:
-                        reset(game);
+                        if (recording)
+                            stop_movie(game);
+                        reset();
                         break;
 	
 					// Goes into fullscreen or windowed mode
@@ -384,6 +578,14 @@ void chip8::handle_input(SDL_Window*& window, config& config, std::string game)
 					case SDLK_f: keypad[0xE] = false; break;
 					case SDLK_v: keypad[0xF] = false; break;
 
+                    case SDLK_TAB:
+                        fast_forward = false;
+                        break;
+
+                    case SDLK_BACKSPACE:
+                        rewinding = false;
+                        break;
+
 					default: break;
 				}
 				break;
@@ -391,500 +593,169 @@ void chip8::handle_input(SDL_Window*& window, config& config, std::string game)
 	}
 }
 
-void chip8::reset(std::string game)
-{
-    // Clear registers and screen
-    PC = 0x200;
-    ST = 0;
-    DT = 0;
-    SP = 0;
-    I = 0;
-    clear_screen();
-
-    for (uint8_t i = 0; i < 16; i++)
-    {
-        V[i] = 0;
-    }
-
-    // Clear game memory and stack
-    for (uint16_t i = 0x200; i < 4096; i++)
-    {
-        memory[i] = 0x00;
-    }
-
-    while (!stack.empty())
-    {
-        stack.pop();
-    }
-
-    // Reload rom into memory
-    std::ifstream ifs;
-    ifs.open(game, std::ifstream::binary);
-    if (!ifs.is_open())
-    {
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    std::streampos file_size = ifs.tellg();
-    ifs.seekg(0, std::ios::beg);
-    ifs.read(reinterpret_cast<char*>(memory + 0x200), file_size);
-    ifs.close();
-}
-
-uint8_t chip8::read(uint16_t program_counter)
-{
-	return memory[program_counter];
-}
-
-uint16_t chip8::fetch(uint16_t& program_counter)
-{
-    // Gets the 16 bit instruction
-	uint16_t hiByte = read(program_counter);
-	program_counter++;
-	uint16_t loByte = read(program_counter);
-    program_counter++;
-
-	uint16_t opcode = (hiByte << 8) | loByte;
-	return opcode;
-}
-
-void chip8::decode(uint16_t opcode)
-{
-    // Decodes and runs the opcode
-	switch (opcode & 0xF000)
-	{
-		case 0x0000:
-			switch (opcode & 0x0F00)
-			{
-				case 0x0000:
-					switch (opcode & 0x00FF)
-					{
-						case 0x00E0:
-							clear_screen(); // 00E0
-							break;
-						case 0x00EE:
-							return_from_subroutine(); // 00EE
-							break;
-					}
-					break;
-			}
-			break;
-		case 0x1000:
-			jump(opcode & 0x0FFF); // 1NNN
-			break;
-		case 0x2000:
-			call_subroutine(opcode & 0x0FFF); // 2NNN
-			break;
-		case 0x3000:
-			equal_skip((opcode & 0x0F00) >> 8, opcode & 0x00FF); // 3XNN
-			break;
-		case 0x4000:
-			unequal_skip((opcode & 0x0F00) >> 8, opcode & 0x00FF); // 4XNN
-			break;
-		case 0x5000:
-			equal_register_skip((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 5XY0
-			break;
-		case 0x6000:
-			set_vx((opcode & 0x0F00) >> 8, opcode & 0x00FF); // 6XNN
-			break;
-		case 0x7000:
-			add_vx((opcode & 0x0F00) >> 8, opcode & 0x00FF); // 7XNN
-			break;
-		case 0x8000:
-			switch (opcode & 0x000F)
-			{
-				case 0x0000:
-					logical_set((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY0
-					break;
-				case 0x0001:
-					logical_OR((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY1
-					break;
-				case 0x0002:
-					logical_AND((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY2
-					break;
-				case 0x0003:
-					logical_XOR((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY3
-					break;
-				case 0x0004:
-					logical_add((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY4
-					break;
-				case 0x0005:
-					logical_subtract((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY5
-					break;
-				case 0x0006:
-					shift_right((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY6
-					break;
-				case 0x0007:
-					logical_subtract_reverse((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XY7
-					break;
-				case 0x000E:
-					shift_left((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 8XYE
-					break;
-			}
-			break;
-		case 0x9000:
-			unequal_register_skip((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); // 9XY0
-			break;
-		case 0xA000:
-			set_index(opcode & 0x0FFF); // ANNN
-			break;
-		case 0xB000:
-			offset_jump(opcode & 0x0FFF); // BNNN
-			break;
-		case 0xC000:
-			random((opcode & 0x0F00) >> 8, opcode & 0x00FF); // CXNN
-			break;
-		case 0xD000:
-			draw((opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4, opcode & 0x000F); // DXYN
-			break;
-		case 0xE000:
-			switch (opcode & 0x00FF)
-			{
-				case 0x009E:
-					skip_if_key((opcode & 0x0F00) >> 8); // EX9E
-					break;
-				case 0x00A1:
-					skip_if_not_key((opcode & 0x0F00) >> 8); // EXA1
-					break;
-			}
-			break;
-		case 0xF000:
-			switch (opcode & 0x00FF)
-			{
-				case 0x0007:
-					get_delay_timer((opcode & 0x0F00) >> 8); // FX07
-					break;
-				case 0x0015:
-					set_delay_timer((opcode & 0x0F00) >> 8); // FX15
-					break;
-				case 0x0018:
-					set_sound_timer((opcode & 0x0F00) >> 8); // FX18
-					break;
-				case 0x0029:
-					point_font((opcode & 0x0F00) >> 8); // FX29
-					break;
-				case 0x0033:
-					decimal_conversion((opcode & 0x0F00) >> 8); // FX33
-					break;
-				case 0x0055:
-					store_memory((opcode & 0x0F00) >> 8); // FX55
-					break;
-				case 0x0065:
-					load_memory((opcode & 0x0F00) >> 8); // FX65
-					break;
-				case 0x001E:
-					add_index((opcode & 0x0F00) >> 8); // FX1E
-					break;
-				case 0x000A:
-					get_key((opcode & 0x0F00) >> 8);  // FX0A
-					break;
-			}
-			break;
-	}
-}
-
-// Opcodes
-void chip8::clear_screen()
-{
-	for (uint8_t x = 0; x < 64; x++)
-	{
-		for (uint8_t y = 0; y < 32; y++)
-		{
-		    display[x][y] = false;
-		}
-	}
-}
-
-void chip8::jump(uint16_t address)
+void chip8::save_slot(uint8_t slot, const std::string& game)
 {
-	PC = address;
+    save_state(slots[slot]);
+    slot_saved[slot] = true;
+    if (!save_state(slot_path(slot, game)))
+        SDL_Log("Could not write save state %u to disk", slot + 1);
 }
 
-void chip8::call_subroutine(uint16_t address)
+void chip8::load_slot(uint8_t slot, const std::string& game)
 {
-	stack.push(PC);
-	PC = address;
+    // Falls back to the file from an earlier session when the slot is empty
+    if (slot_saved[slot])
+        load_state(slots[slot]);
+    else if (!load_state(slot_path(slot, game)))
+        SDL_Log("Save state %u is empty or belongs to another ROM", slot + 1);
 }
 
-void chip8::return_from_subroutine()
+std::string chip8::slot_path(uint8_t slot, const std::string& game)
 {
-	PC = stack.top();
-	stack.pop();
+    // BRIX.ch8 keeps its slots in BRIX.1.c8s to BRIX.4.c8s
+    std::filesystem::path path = game;
+    path.replace_extension("." + std::to_string(slot + 1) + ".c8s");
+    return path.string();
 }
 
-void chip8::set_vx(uint8_t x, uint8_t value)
+void chip8::run_emulated_frame()
 {
-	V[x] = value;
+    // Every frame the game really runs goes into the movie, run-ahead frames do not
+    if (recording)
+        movie.record(*this);
+    run_frame();
 }
 
-void chip8::add_vx(uint8_t x, uint8_t value)
+void chip8::upload_screen()
 {
-	V[x] += value;
-}
+    // Converts the dirty rows through the palette, then uploads the span of rows they cover
+    if (dirty_rows == 0)
+        return;
 
-void chip8::set_index(uint16_t value)
-{
-	I = value;
-}
+    uint8_t first = 31;
+    uint8_t last = 0;
+    for (uint8_t y = 0; y < 32; y++)
+    {
+        if (!((dirty_rows >> y) & 1))
+            continue;
 
-void chip8::draw(uint8_t x, uint8_t y, uint8_t n)
-{
-	if (settings.display_wait == true)
-	{
-        if (loop_index != 0)
+        const uint64_t row = display[y];
+        for (uint8_t x = 0; x < 64; x++)
         {
-            PC -= 2;
-            return;
+            screen_pixels[y][x] = palette[(row >> (63 - x)) & 1];
         }
-	}
-
-	uint8_t x_coor = V[x] & 63;
-    uint8_t original_x_coor = x_coor;
-	uint8_t y_coor = V[y] & 31;
-	V[0xF] = 0;
-
-	for (uint8_t i = 0; i < n; i++)
-	{
-		uint8_t sprite = memory[I + i];
-		for (int8_t j = 7; j >= 0; j--)
-		{
-			uint8_t bit = (sprite >> j) & 0x1;
-			if (bit == 1)
-			{
-                if (!settings.wrapping && x_coor > 63)
-                    break;
-
-				if (display[x_coor][y_coor] == 1)
-					V[0xF] = 1;
-				display[x_coor][y_coor] ^= 1;
-			}
-			x_coor++;
-
-            if(settings.wrapping)
-                x_coor %= 64;
-		}
-        x_coor = original_x_coor;
-		y_coor++;
-
-        if (settings.wrapping)
-            y_coor %= 32;
-        else if (y_coor > 31)
-		{
-			break; 
-		}
-	}
-}
-
-void chip8::equal_skip(uint8_t x, uint8_t y)
-{
-	if (V[x] == y)
-	{
-		PC += 2;
-	}
-}
-
-void chip8::unequal_skip(uint8_t x, uint8_t y)
-{
-	if (V[x] != y)
-	{
-		PC += 2;
-	}
-}
-
-void chip8::equal_register_skip(uint8_t x, uint8_t y)
-{
-	if (V[x] == V[y])
-	{
-		PC += 2;
-	}
-}
-
-void chip8::unequal_register_skip(uint8_t x, uint8_t y)
-{
-	if (V[x] != V[y])
-	{
-		PC += 2;
-	}
-}
-
-void chip8::logical_set(uint8_t x, uint8_t y)
-{
-	V[x] = V[y];
-}
-
-void chip8::logical_OR(uint8_t x, uint8_t y)
-{
-	V[x] |= V[y];
-    if (settings.logic == true)
-        V[0x0F] = 0;
-}
-
-void chip8::logical_AND(uint8_t x, uint8_t y)
-{
-	V[x] &= V[y];
-    if (settings.logic == true)
-	    V[0x0F] = 0;
-}
-
-void chip8::logical_XOR(uint8_t x, uint8_t y)
-{
-	V[x] ^= V[y];
-    if (settings.logic == true)
-	    V[0x0F] = 0;
-}
-
-void chip8::logical_add(uint8_t x, uint8_t y)
-{
-	uint8_t temp = V[x];
-	if ((V[x] + V[y]) > 255)
-		temp = 1;
-	else
-		temp = 0;
-
-	V[x] += V[y];
-	V[0xF] = temp;
-	
-}
-
-void chip8::logical_subtract(uint8_t x, uint8_t y)
-{
-	uint8_t temp;
-	if (V[x] >= V[y])
-		temp = 1;
-	else
-		temp = 0;
-
-	V[x] -= V[y];
-	V[0xF] = temp;
-}
-
-void chip8::logical_subtract_reverse(uint8_t x, uint8_t y)
-{
-	uint8_t temp;
-	if (V[y] >= V[x])
-		temp = 1;
-	else
-		temp = 0;
-
-	V[x] = V[y] - V[x];
-	V[0xF] = temp;
-}
-
-void chip8::shift_right(uint8_t x, uint8_t y)
-{
-	V[x] = V[y];
-	uint8_t bit = V[x] & 0x01;
-	V[x] = V[x] >> 1;
-	V[0xF] = bit;
-}
-
-void chip8::shift_left(uint8_t x, uint8_t y)
-{
-	V[x] = V[y];
-	uint8_t bit = (V[x] & 0x80) >> 7;
-	V[x] = V[x] << 1;
-	V[0xF] = bit;
-}
-
-void chip8::offset_jump(uint16_t value)
-{
-	PC = value + V[0];
-}
-
-void chip8::random(uint8_t x, uint8_t value)
-{
-	uint8_t random = (rand() % 0xFF) & value;
-	V[x] = random;
-}
-
-void chip8::get_delay_timer(uint8_t x)
-{
-	V[x] = DT;
-}
-
-void chip8::set_delay_timer(uint8_t x)
-{
-	DT = V[x];
-}
-
-void chip8::set_sound_timer(uint8_t x)
-{
-	ST = V[x];
-}
-
-void chip8::add_index(uint8_t x)
-{
-	I += V[x];
-	if (I >= 0x1000)
-		V[0xF] = 1;
-}
+        if (y < first) first = y;
+        last = y;
+    }
 
-void chip8::point_font(uint8_t x)
-{
-	I = 0x50 + (5 * (V[x] & 0xF));
+    const SDL_Rect rows = { 0, first, 64, last - first + 1 };
+    SDL_UpdateTexture(screen, &rows, screen_pixels[first], sizeof(screen_pixels[0]));
+    dirty_rows = 0;
 }
 
-void chip8::decimal_conversion(uint8_t x)
+void chip8::draw_hud(SDL_Window* window, SDL_Renderer* renderer)
 {
-	memory[I] = V[x] / 100;
-	memory[I + 1] = (V[x] / 10) % 10;
-	memory[I + 2] = V[x] % 10;
-
-}
+    // The overlay has its own ImGui context on the game's renderer, the launcher's stays untouched
+    ImGuiContext* launcher_context = ImGui::GetCurrentContext();
+    if (hud_context == nullptr)
+    {
+        hud_context = ImGui::CreateContext();
+        ImGui::SetCurrentContext(hud_context);
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.ConfigFlags |= ImGuiConfigFlags_NoMouseCursorChange;
+        ImGui_ImplSDL2_InitForSDLRenderer(window, renderer);
+        ImGui_ImplSDLRenderer2_Init(renderer);
+    }
+    ImGui::SetCurrentContext(hud_context);
+
+    // The game is drawn at 64x32 and scaled up, the overlay at the window's own resolution
+    SDL_RenderSetLogicalSize(renderer, 0, 0);
+    ImGui_ImplSDLRenderer2_NewFrame();
+    ImGui_ImplSDL2_NewFrame();
+    ImGuiIO& io = ImGui::GetIO();
+    io.FontGlobalScale = io.DisplaySize.y >= 960 ? 2.0f : 1.0f;
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2(8, 8));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    ImGui::Begin("##HUD", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoSavedSettings);
+    if (timing == timing_vip)
+        ImGui::Text("IPS: COSMAC VIP timing, executed %.0f", hud.achieved_ips);
+    else
+        ImGui::Text("IPS: target %u, executed %.0f", IPS, hud.achieved_ips);
+    ImGui::Text("Opcodes: %.1f us", hud.emulate_us);
+    ImGui::Text("Upload:  %.1f us", hud.draw_us);
+    ImGui::Text("Present: %.1f us", hud.present_us);
+    ImGui::Text("Sleep:   %.1f ms", hud.sleep_ms);
+    ImGui::Text("Frames:  %u shown, %u unchanged, %u late of %u, %llu late in total",
+        hud.shown, hud.unchanged, hud.late, hud.frames, (unsigned long long)late_frames);
+
+    const char* audio_states[] = { "stopped", "playing", "paused" };
+    SDL_AudioStatus audio = SDL_GetAudioDeviceStatus(dev);
+    ImGui::Text("Audio:   %s, %d Hz, %u samples%s", audio_states[audio <= SDL_AUDIO_PAUSED ? audio : 0],
+        have.freq, have.samples, sound ? ", beeping" : "");
+    ImGui::End();
+
+    ImGui::Render();
+    SDL_RenderSetScale(renderer, io.DisplayFramebufferScale.x, io.DisplayFramebufferScale.y);
+    ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
+    SDL_RenderSetLogicalSize(renderer, 64, 32);
+    ImGui::SetCurrentContext(launcher_context);
+}
+
+void chip8::destroy_hud()
+{
+    if (hud_context == nullptr)
+        return;
 
-void chip8::store_memory(uint8_t x)
-{
-	for (uint8_t i = 0; i <= x; i++)
-	{
-		memory[I] = V[i];
-		I++;
-	}
+    ImGuiContext* launcher_context = ImGui::GetCurrentContext();
+    ImGui::SetCurrentContext(hud_context);
+    ImGui_ImplSDLRenderer2_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext(hud_context);
+    hud_context = nullptr;
+    ImGui::SetCurrentContext(launcher_context);
 }
 
-void chip8::load_memory(uint8_t x)
+void chip8::start_movie(const std::string& game)
 {
-	for (uint8_t i = 0; i <= x; i++)
-	{
-		V[i] = memory[I];
-		I++;
-	}
+    // Movies start from power on, so the replay only needs the ROM and the settings
+    if (!load(game))
+        return;
+    set_speed(IPS);
+    set_timing(settings.vip_timing ? timing_vip : timing_flat);
+    history.clear();
+    movie.begin(*this);
+    recording = true;
+    SDL_Log("Recording a movie from power on");
 }
 
-void chip8::skip_if_key(uint8_t x)
+void chip8::stop_movie(const std::string& game)
 {
-	if (keypad[V[x]] == true)
-	{
-		PC += 2;
-	}
+    movie.end(*this);
+    recording = false;
+    if (movie.save(movie_path(game)))
+        SDL_Log("Saved a movie of %u frames with %zu key changes to %s",
+            movie.frames, movie.events(), movie_path(game).c_str());
+    else
+        SDL_Log("Could not write the movie to disk");
 }
 
-void chip8::skip_if_not_key(uint8_t x)
+std::string chip8::movie_path(const std::string& game)
 {
-	if (keypad[V[x]] == false)
-	{
-		PC += 2;
-	}
+    // BRIX.ch8 records into BRIX.c8m
+    std::filesystem::path path = game;
+    path.replace_extension(".c8m");
+    return path.string();
 }
 
-void chip8::get_key(uint8_t x)
+uint8_t chip8::profile_from_config(const nlohmann::json& config)
 {
-	int8_t key_pressed = -1;
-    for (uint8_t i = 0; i <= 0x0F; i++)
-    {
-        if (keypad[i] == true)
-        {
-            key_pressed = i;
-            break;
-        }
-    }
-
-    if (pressed_key > -1 && keypad[pressed_key] == false)
-    {
-        V[x] = pressed_key;
-        pressed_key = -1;
-    }
-    else PC -= 2;
+    if (config.contains("profile"))
+        return find_profile(config["profile"]);
 
-    if (key_pressed > -1) pressed_key = key_pressed;
+    // Older configs stored loose quirk switches instead of a profile, and keep exactly those quirks
+    return legacy_profile(config.value("logic", true), config.value("wrapping", false), config.value("display_wait", false));
 }
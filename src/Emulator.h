@@ -5,41 +5,34 @@
 #include <cmath>
 #include <stdint.h>
 #include <fstream>
+#include "Core.h"
+#include "Movie.h"
+#include "Rewind.h"
 #include "json.hpp"
 #include "SDL.h"
-#include <stack>
 #include <string>
 #include <windows.h>
 
-class chip8
+struct ImGuiContext;
+
+// SDL frontend around the emulation core
+class chip8 : public chip8_core
 {
 public:
+    static uint8_t profile_from_config(const nlohmann::json& config);
+
     struct config
     {
         int volume;
-        bool display_wait;
         bool fullscreen;
-        bool logic;
-        bool wrapping;
+        bool jit;
+        bool vip_timing;
+        uint8_t profile;
+        int run_ahead; // Frames shown ahead of the real machine, 0 for off
+        uint32_t seed; // CXNN random generator seed, the same seed and keys replay the same game
+        int fast_forward; // Frames run per host frame while Tab is held
     } settings;
 
-    uint8_t memory[4096]; // 4096 bytes or 4 kilobytes of memory
-    uint32_t IPS; // Instructions per second
-    uint32_t IPF; // Instructions per frame
-
-    // Registers
-    uint8_t V[16];
-    uint16_t I;
-    uint8_t DT; // Delay Timer
-    uint8_t ST; // Sound timer
-    uint16_t PC; // Program Counter
-    uint8_t SP; // Stack Pointer
-    std::stack<uint16_t> stack; // Stack
-    bool keypad[16]; // Key inputs
-
-    // Display
-    bool display[64][32]; // 64x32 display
-
     // Pixel on color
     uint8_t pixel_on_R;
     uint8_t pixel_on_G;
@@ -50,10 +43,51 @@ public:
     uint8_t pixel_off_G;
     uint8_t pixel_off_B;
 
-    uint16_t loop_index;
+    // The display is converted through the palette a row at a time into one streaming
+    // texture, and only rows the core marked dirty are converted and uploaded
+    SDL_Texture* screen = nullptr;
+    uint32_t palette[2]; // ARGB8888 for pixels off and on
+    uint32_t screen_pixels[32][64];
+    bool redraw = true; // Window needs presenting even if no row changed
+
     bool running = true;
     bool paused = false;
-    int8_t pressed_key;
+    bool turbo = false;
+    bool fast_forward = false;
+
+    // Save state slots on F1-F4, also written next to the ROM so they last between sessions
+    static const uint8_t slot_count = 4;
+    state slots[slot_count];
+    bool slot_saved[slot_count] = {};
+
+    // Every frame is recorded so holding Backspace plays the game backwards
+    rewind_buffer history;
+    bool rewinding = false;
+
+    // Real machine and its counters while the frames shown ahead of it are run
+    state run_ahead_state;
+    statistics run_ahead_statistics;
+
+    // Performance overlay on F7, averaged over the last second
+    bool show_hud = false;
+    struct hud_stats
+    {
+        double achieved_ips;
+        double emulate_us; // Opcode slice, the emulated frames of one host frame
+        double draw_us;    // Texture upload and copy
+        double present_us; // SDL_RenderPresent
+        double sleep_ms;   // Passed to SDL_Delay
+        uint32_t frames;   // Host frames
+        uint32_t shown;    // Frames drawn and presented
+        uint32_t late;     // Frames not drawn because they missed their deadline
+        uint32_t unchanged; // Frames not presented because no row changed
+    } hud = {};
+    uint64_t late_frames = 0;
+    ImGuiContext* hud_context = nullptr;
+
+    // F9 restarts the game and records its keys into a movie until pressed again
+    input_movie movie;
+    bool recording = false;
 
     // Audio sample rate and frequency
     SDL_AudioSpec want, have;
@@ -68,48 +102,17 @@ public:
 private:
     bool init_sdl(SDL_Window*& window, SDL_Renderer*& renderer, std::string game, std::string path);
     bool init_audio(config config);
-    bool init_chip8(std::string game);
     void handle_input(SDL_Window*& window, config& config, std::string game);
-    void clear_screen();
-    void reset(std::string game);
-    uint8_t read(uint16_t program_counter);
-    uint16_t fetch(uint16_t& program_counter);
-    void decode(uint16_t instruction);
-
-    // Opcodes
-    void jump(uint16_t address);
-    void call_subroutine(uint16_t address);
-    void return_from_subroutine();
-    void set_vx(uint8_t x, uint8_t value);
-    void add_vx(uint8_t x, uint8_t value);
-    void set_index(uint16_t value);
-    void draw(uint8_t x, uint8_t y, uint8_t n);
-    void equal_skip(uint8_t x, uint8_t y);
-    void unequal_skip(uint8_t x, uint8_t y);
-    void equal_register_skip(uint8_t x, uint8_t y);
-    void unequal_register_skip(uint8_t x, uint8_t y);
-    void logical_set(uint8_t x, uint8_t y);
-    void logical_OR(uint8_t x, uint8_t y);
-    void logical_AND(uint8_t x, uint8_t y);
-    void logical_XOR(uint8_t x, uint8_t y);
-    void logical_add(uint8_t x, uint8_t y);
-    void logical_subtract(uint8_t x, uint8_t y);
-    void logical_subtract_reverse(uint8_t x, uint8_t y);
-    void shift_right(uint8_t x, uint8_t y);
-    void shift_left(uint8_t x, uint8_t y);
-    void offset_jump(uint16_t value);
-    void random(uint8_t x, uint8_t value);
-    void get_delay_timer(uint8_t x);
-    void set_delay_timer(uint8_t x);
-    void set_sound_timer(uint8_t x);
-    void add_index(uint8_t x);
-    void point_font(uint8_t x);
-    void decimal_conversion(uint8_t x);
-    void store_memory(uint8_t x);
-    void load_memory(uint8_t x);
-    void skip_if_key(uint8_t x);
-    void skip_if_not_key(uint8_t x);
-    void get_key(uint8_t x);
+    void run_emulated_frame();
+    void upload_screen();
+    void draw_hud(SDL_Window* window, SDL_Renderer* renderer);
+    void destroy_hud();
+    void save_slot(uint8_t slot, const std::string& game);
+    void load_slot(uint8_t slot, const std::string& game);
+    static std::string slot_path(uint8_t slot, const std::string& game);
+    void start_movie(const std::string& game);
+    void stop_movie(const std::string& game);
+    static std::string movie_path(const std::string& game);
 };
 
 #endif
@@ -0,0 +1,91 @@
+#include "Environment.h"
+
+chip8_env::chip8_env(size_t count)
+    : machines(count)
+{
+    frame_skip = 1;
+    frames.assign(count, 0);
+}
+
+bool chip8_env::load(const std::string& game, uint8_t profile, uint32_t ips)
+{
+    machines.select_profile(profile);
+    machines.set_speed(ips);
+    return machines.load(game);
+}
+
+void chip8_env::reset(uint32_t seed)
+{
+    for (size_t env = 0; env < size(); env++)
+    {
+        reset(env, seed + (uint32_t)env);
+    }
+}
+
+void chip8_env::reset(size_t env, uint32_t seed)
+{
+    machines.seed(env, seed);
+    machines.reset(env);
+    frames[env] = 0;
+}
+
+void chip8_env::step(const uint16_t* actions)
+{
+    for (size_t env = 0; env < size(); env++)
+    {
+        machines.set_keys(env, actions[env]);
+        frames[env] += frame_skip;
+    }
+
+    for (uint32_t i = 0; i < frame_skip; i++)
+    {
+        machines.run_frame();
+    }
+}
+
+chip8_env* chip8_env_create(const char* game, size_t count, const char* profile, uint32_t ips, uint32_t frame_skip)
+{
+    chip8_env* env = new chip8_env(count);
+    if (!env->load(game, chip8_core::find_profile(profile), ips))
+    {
+        delete env;
+        return nullptr;
+    }
+    env->set_frame_skip(frame_skip);
+    return env;
+}
+
+void chip8_env_destroy(chip8_env* env)
+{
+    delete env;
+}
+
+void chip8_env_reset(chip8_env* env, uint32_t seed)
+{
+    env->reset(seed);
+}
+
+void chip8_env_reset_one(chip8_env* env, size_t index, uint32_t seed)
+{
+    env->reset(index, seed);
+}
+
+void chip8_env_step(chip8_env* env, const uint16_t* actions)
+{
+    env->step(actions);
+}
+
+const uint64_t* chip8_env_observations(const chip8_env* env)
+{
+    return env->observations();
+}
+
+const uint8_t* chip8_env_memories(const chip8_env* env)
+{
+    return env->memories();
+}
+
+const uint32_t* chip8_env_episode_frames(const chip8_env* env)
+{
+    return env->episode_frames();
+}
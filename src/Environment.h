@@ -0,0 +1,61 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "VectorCore.h"
+
+// Gym style batch of environments over one ROM. step() runs every environment in a
+// single call on the vector machine, and the observations are its display buffer,
+// so callers read the framebuffers in place instead of copying them out.
+class chip8_env
+{
+public:
+    explicit chip8_env(size_t count);
+
+    bool load(const std::string& game, uint8_t profile, uint32_t ips = 700);
+    void set_frame_skip(uint32_t frames) { frame_skip = frames > 0 ? frames : 1; }
+
+    // Restarts every environment, environment N seeded with seed + N
+    void reset(uint32_t seed);
+    // Restarts one environment whose episode ended, the others keep going
+    void reset(size_t env, uint32_t seed);
+    // Holds each environment's key mask, bit N for key N, for frame_skip frames
+    void step(const uint16_t* actions);
+
+    size_t size() const { return machines.lanes(); }
+
+    // count * 32 rows of 64 bits, bit 63 of a row is x = 0
+    const uint64_t* observations() const { return machines.framebuffers(); }
+    static const size_t observation_size = 32 * sizeof(uint64_t);
+    // count * 4096 bytes of memory, for reward functions that read the game's variables
+    const uint8_t* memories() const { return machines.memories(); }
+    // Frames run since each environment was last reset
+    const uint32_t* episode_frames() const { return frames.data(); }
+
+private:
+    chip8_vector machines;
+    uint32_t frame_skip;
+    std::vector<uint32_t> frames;
+};
+
+// C interface so other languages can load the library and map the buffers,
+// for example with ctypes and numpy
+#if defined(_WIN32)
+#define CHIP8_ENV_API extern "C" __declspec(dllexport)
+#else
+#define CHIP8_ENV_API extern "C" __attribute__((visibility("default")))
+#endif
+
+CHIP8_ENV_API chip8_env* chip8_env_create(const char* game, size_t count, const char* profile, uint32_t ips, uint32_t frame_skip);
+CHIP8_ENV_API void chip8_env_destroy(chip8_env* env);
+CHIP8_ENV_API void chip8_env_reset(chip8_env* env, uint32_t seed);
+CHIP8_ENV_API void chip8_env_reset_one(chip8_env* env, size_t index, uint32_t seed);
+CHIP8_ENV_API void chip8_env_step(chip8_env* env, const uint16_t* actions);
+CHIP8_ENV_API const uint64_t* chip8_env_observations(const chip8_env* env);
+CHIP8_ENV_API const uint8_t* chip8_env_memories(const chip8_env* env);
+CHIP8_ENV_API const uint32_t* chip8_env_episode_frames(const chip8_env* env);
+
+#endif
@@ -0,0 +1,304 @@
+#include "Jit.h"
+#include "Core.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+// Register numbers used in ModRM encodings
+static const uint8_t reg_al = 0;
+static const uint8_t reg_cl = 1;
+
+jit::jit()
+{
+    code_buffer = nullptr;
+    code_used = 0;
+    cursor = nullptr;
+    block_count = 0;
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        blocks[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        page_blocks[i] = 0;
+    }
+}
+
+jit::~jit()
+{
+    if (code_buffer == nullptr)
+        return;
+
+#if defined(_WIN32)
+    VirtualFree(code_buffer, 0, MEM_RELEASE);
+#else
+    munmap(code_buffer, code_size);
+#endif
+}
+
+bool jit::init()
+{
+#if JIT_SUPPORTED
+#if defined(_WIN32)
+    code_buffer = (uint8_t*)VirtualAlloc(NULL, code_size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+    void* memory = mmap(NULL, code_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code_buffer = memory == MAP_FAILED ? nullptr : (uint8_t*)memory;
+#endif
+#endif
+    return code_buffer != nullptr;
+}
+
+void jit::flush()
+{
+    // Only called between blocks, so no translated code is running
+    code_used = 0;
+    block_count = 0;
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        blocks[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        page_blocks[i] = 0;
+    }
+}
+
+void jit::remove(block* translated)
+{
+    blocks[translated->start] = nullptr;
+    for (uint16_t page = translated->start >> 8; page <= ((translated->end - 1) >> 8); page++)
+    {
+        page_blocks[page]--;
+    }
+}
+
+void jit::invalidate(uint16_t address)
+{
+    // Drops every block overlapping the written page. The code itself stays
+    // in the buffer until the next flush, since a block may still be running.
+    uint16_t page = (address & 0xFFF) >> 8;
+    if (page_blocks[page] == 0)
+        return;
+
+    int32_t page_start = page << 8;
+    int32_t first = page_start - max_block_length * 2;
+    if (first < 0)
+        first = 0;
+
+    for (int32_t i = first; i < page_start + 256; i++)
+    {
+        block* translated = blocks[i];
+        if (translated != nullptr && translated->end > page_start)
+            remove(translated);
+    }
+}
+
+void jit::emit(uint8_t byte)
+{
+    *cursor++ = byte;
+}
+
+void jit::emit16(uint16_t value)
+{
+    emit(value & 0xFF);
+    emit(value >> 8);
+}
+
+void jit::emit32(uint32_t value)
+{
+    emit16(value & 0xFFFF);
+    emit16(value >> 16);
+}
+
+void jit::emit64(uint64_t value)
+{
+    emit32(value & 0xFFFFFFFF);
+    emit32(value >> 32);
+}
+
+void jit::emit_rbx(uint8_t opcode, uint8_t reg, int32_t offset)
+{
+    // <opcode> reg, [rbx + disp32]
+    emit(opcode);
+    emit(0x83 | (reg << 3));
+    emit32(offset);
+}
+
+void jit::emit_prologue()
+{
+    emit(0x53);                                 // push rbx
+    emit(0x48); emit(0x83); emit(0xEC); emit(0x20); // sub rsp, 32
+#if defined(_WIN32)
+    emit(0x48); emit(0x89); emit(0xCB);         // mov rbx, rcx
+#else
+    emit(0x48); emit(0x89); emit(0xFB);         // mov rbx, rdi
+#endif
+}
+
+void jit::emit_epilogue()
+{
+    emit(0x48); emit(0x83); emit(0xC4); emit(0x20); // add rsp, 32
+    emit(0x5B);                                 // pop rbx
+    emit(0xC3);                                 // ret
+}
+
+void jit::emit_call(chip8_core& emulator, uint16_t address, uint8_t index)
+{
+    int32_t loop_index = (int32_t)((uint8_t*)&emulator.loop_index - (uint8_t*)&emulator);
+
+    // Handlers such as draw look at loop_index, so it has to match the interpreter
+    if (index > 0)
+    {
+        emit_rbx(0x81, 0, loop_index); emit32(index); // add dword [loop_index], index
+    }
+
+#if defined(_WIN32)
+    emit(0x48); emit(0x89); emit(0xD9);         // mov rcx, rbx
+    emit(0x48); emit(0xBA);                     // mov rdx, imm64
+#else
+    emit(0x48); emit(0x89); emit(0xDF);         // mov rdi, rbx
+    emit(0x48); emit(0xBE);                     // mov rsi, imm64
+#endif
+    emit64((uint64_t)(uintptr_t)&emulator.decoded[address]);
+    emit(0x48); emit(0xB8);                     // mov rax, imm64
+    emit64((uint64_t)(uintptr_t)&chip8_core::jit_call);
+    emit(0xFF); emit(0xD0);                     // call rax
+
+    if (index > 0)
+    {
+        emit_rbx(0x81, 5, loop_index); emit32(index); // sub dword [loop_index], index
+    }
+}
+
+jit::block* jit::translate(chip8_core& emulator, uint16_t address)
+{
+    // Blocks never wrap around the end of memory, and idle loops are left to the
+    // interpreter so it can fast-forward them
+    address &= 0xFFF;
+    if (address > 0xFFD || emulator.idle_loop(address))
+        return nullptr;
+
+    if (block_count == max_blocks || code_used + max_block_code > code_size)
+        flush();
+
+    uint8_t* base = (uint8_t*)&emulator;
+    int32_t PC = (int32_t)((uint8_t*)&emulator.PC - base);
+    int32_t I = (int32_t)((uint8_t*)&emulator.I - base);
+    int32_t V = (int32_t)((uint8_t*)emulator.V - base);
+    int32_t VF = V + 0xF;
+
+    block* translated = &pool[block_count++];
+    translated->start = address;
+    translated->code = (block_code)(code_buffer + code_used);
+    cursor = code_buffer + code_used;
+    emit_prologue();
+
+    uint16_t pc = address;
+    uint8_t length = 0;
+    bool terminated = false;
+    while (!terminated && length < max_block_length && pc + 2 <= 0xFFF)
+    {
+        chip8_core::micro_op& op = emulator.decoded[pc];
+        if (op.handler == nullptr)
+        {
+            uint16_t program_counter = pc;
+            op = emulator.predecode(emulator.fetch(program_counter));
+        }
+
+        switch (chip8_core::dispatch_table[op.opcode])
+        {
+            case chip8_core::op_set_vx:
+                emit(0xC6); emit(0x83); emit32(V + op.x); emit(op.nn); // mov byte [Vx], nn
+                break;
+            case chip8_core::op_add_vx:
+                emit(0x80); emit(0x83); emit32(V + op.x); emit(op.nn); // add byte [Vx], nn
+                break;
+            case chip8_core::op_set_index:
+                emit(0x66); emit(0xC7); emit(0x83); emit32(I); emit16(op.nnn); // mov word [I], nnn
+                break;
+            case chip8_core::op_logical_set:
+                emit_rbx(0x8A, reg_al, V + op.y); // mov al, [Vy]
+                emit_rbx(0x88, reg_al, V + op.x); // mov [Vx], al
+                break;
+            case chip8_core::op_logical_OR:
+            case chip8_core::op_logical_AND:
+            case chip8_core::op_logical_XOR:
+            {
+                uint8_t alu = 0x0A; // or al, [Vy]
+                if (chip8_core::dispatch_table[op.opcode] == chip8_core::op_logical_AND) alu = 0x22;
+                if (chip8_core::dispatch_table[op.opcode] == chip8_core::op_logical_XOR) alu = 0x32;
+                emit_rbx(0x8A, reg_al, V + op.x);
+                emit_rbx(alu, reg_al, V + op.y);
+                emit_rbx(0x88, reg_al, V + op.x);
+                if (emulator.active_quirks->logic)
+                {
+                    emit(0xC6); emit(0x83); emit32(VF); emit(0); // mov byte [VF], 0
+                }
+                break;
+            }
+            case chip8_core::op_logical_add:
+                emit_rbx(0x8A, reg_al, V + op.x);    // mov al, [Vx]
+                emit_rbx(0x02, reg_al, V + op.y);    // add al, [Vy]
+                emit(0x0F); emit(0x92); emit(0xC1);  // setc cl
+                emit_rbx(0x88, reg_al, V + op.x);    // mov [Vx], al
+                emit_rbx(0x88, reg_cl, VF);          // mov [VF], cl
+                break;
+            case chip8_core::op_jump:
+                emit(0x66); emit(0xC7); emit(0x83); emit32(PC); emit16(op.nnn); // mov word [PC], nnn
+                terminated = true;
+                break;
+
+            // Control flow and anything that can rewind PC or write memory ends the block
+            case chip8_core::op_call_subroutine:
+            case chip8_core::op_return_from_subroutine:
+            case chip8_core::op_offset_jump:
+            case chip8_core::op_equal_skip:
+            case chip8_core::op_unequal_skip:
+            case chip8_core::op_equal_register_skip:
+            case chip8_core::op_unequal_register_skip:
+            case chip8_core::op_skip_if_key:
+            case chip8_core::op_skip_if_not_key:
+            case chip8_core::op_get_key:
+            case chip8_core::op_draw:
+            case chip8_core::op_store_memory:
+            case chip8_core::op_decimal_conversion:
+                emit(0x66); emit(0xC7); emit(0x83); emit32(PC); emit16(pc + 2); // mov word [PC], pc + 2
+                emit_call(emulator, pc, length);
+                terminated = true;
+                break;
+
+            default:
+                emit_call(emulator, pc, length);
+                break;
+        }
+
+        pc += 2;
+        length++;
+    }
+
+    if (!terminated)
+    {
+        emit(0x66); emit(0xC7); emit(0x83); emit32(PC); emit16(pc); // mov word [PC], pc
+    }
+    emit_epilogue();
+
+    code_used = cursor - code_buffer;
+    translated->end = pc;
+    translated->length = length;
+    blocks[address] = translated;
+    for (uint16_t page = address >> 8; page <= ((pc - 1) >> 8); page++)
+    {
+        page_blocks[page]++;
+    }
+    return translated;
+}
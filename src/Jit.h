@@ -0,0 +1,61 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class chip8_core;
+
+// Translates CHIP-8 basic blocks into native x86-64 code
+class jit
+{
+public:
+    typedef void (*block_code)(chip8_core* emulator);
+
+    struct block
+    {
+        block_code code;
+        uint16_t start; // Address of the first instruction
+        uint16_t end;   // Address after the last instruction
+        uint8_t length; // Instructions in the block
+    };
+
+    jit();
+    ~jit();
+
+    bool init();
+    block* lookup(uint16_t address) { return blocks[address & 0xFFF]; }
+    block* translate(chip8_core& emulator, uint16_t address);
+    void invalidate(uint16_t address);
+    void flush();
+
+private:
+    static const size_t code_size = 1024 * 1024;
+    static const size_t max_block_code = 1024;
+    static const uint8_t max_block_length = 32;
+    static const uint16_t max_blocks = 8192;
+
+    // Executable memory, filled front to back and reclaimed on flush
+    uint8_t* code_buffer;
+    size_t code_used;
+
+    block pool[max_blocks];
+    uint16_t block_count;
+    block* blocks[4096];     // Translated block starting at each address
+    uint16_t page_blocks[16]; // Live blocks overlapping each 256 byte page
+
+    void remove(block* translated);
+
+    // x86-64 emitter
+    uint8_t* cursor;
+    void emit(uint8_t byte);
+    void emit16(uint16_t value);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    void emit_rbx(uint8_t opcode, uint8_t reg, int32_t offset);
+    void emit_prologue();
+    void emit_epilogue();
+    void emit_call(chip8_core& emulator, uint16_t address, uint8_t index);
+};
+
+#endif
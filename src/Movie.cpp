@@ -0,0 +1,222 @@
+#include <fstream>
+#include <iterator>
+#include "Movie.h"
+
+void input_movie::begin(const chip8_core& emulator)
+{
+    rom_hash = emulator.rom_hash();
+    profile = emulator.selected_profile;
+    timing = emulator.timing;
+    IPS = emulator.IPS;
+    seed = emulator.random_seed;
+    frames = 0;
+    final_instructions = 0;
+    final_hash = 0;
+    changes.clear();
+    frame = 0;
+    next = 0;
+    keys = 0;
+    desynced = false;
+}
+
+void input_movie::record(const chip8_core& emulator)
+{
+    uint16_t held = 0;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        held |= emulator.keypad[i] << i;
+    }
+
+    if (held != keys)
+    {
+        changes.push_back({ frame, emulator.instruction_count, held });
+        keys = held;
+    }
+    frame++;
+}
+
+void input_movie::end(const chip8_core& emulator)
+{
+    frames = frame;
+    final_instructions = emulator.instruction_count;
+    final_hash = emulator.framebuffer_hash();
+}
+
+bool input_movie::setup(chip8_core& emulator, const std::string& game)
+{
+    frame = 0;
+    next = 0;
+    keys = 0;
+    desynced = false;
+
+    emulator.select_profile(profile);
+    emulator.seed(seed);
+    if (!emulator.load(game) || emulator.rom_hash() != rom_hash)
+        return false;
+    emulator.set_speed(IPS);
+    emulator.set_timing(timing);
+    return true;
+}
+
+bool input_movie::play_frame(chip8_core& emulator)
+{
+    if (frame >= frames || desynced)
+        return false;
+
+    while (next < changes.size() && changes[next].frame == frame)
+    {
+        // The keys must arrive after exactly as many instructions as when they were recorded
+        if (changes[next].instruction != emulator.instruction_count)
+        {
+            desynced = true;
+            return false;
+        }
+        keys = changes[next].keys;
+        next++;
+    }
+
+    emulator.set_keys(keys);
+    emulator.run_frame();
+    frame++;
+    return true;
+}
+
+bool input_movie::matches(const chip8_core& emulator) const
+{
+    return finished() && !desynced &&
+        emulator.instruction_count == final_instructions &&
+        emulator.framebuffer_hash() == final_hash;
+}
+
+static void put_length(std::vector<uint8_t>& out, uint64_t value)
+{
+    // Seven bits per byte, the top bit set on all but the last
+    while (value >= 0x80)
+    {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+bool input_movie::save(const std::string& path) const
+{
+    // Little endian header, then every change as its frame and instruction distance
+    // from the previous change in LEB128 followed by the 16 bit key mask
+    std::vector<uint8_t> data;
+    auto put = [&data](uint64_t value, uint8_t bytes)
+    {
+        for (uint8_t i = 0; i < bytes; i++)
+        {
+            data.push_back((value >> (i * 8)) & 0xFF);
+        }
+    };
+
+    data.insert(data.end(), { 'C', '8', 'M', 'V' });
+    put(version, 2);
+    put(rom_hash, 8);
+    put(profile, 1);
+    put(timing, 1);
+    put(IPS, 4);
+    put(seed, 4);
+    put(frames, 4);
+    put(final_instructions, 8);
+    put(final_hash, 8);
+    put(changes.size(), 4);
+
+    uint32_t last_frame = 0;
+    uint64_t last_instruction = 0;
+    for (const change& input : changes)
+    {
+        put_length(data, input.frame - last_frame);
+        put_length(data, input.instruction - last_instruction);
+        put(input.keys, 2);
+        last_frame = input.frame;
+        last_instruction = input.instruction;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write((const char*)data.data(), data.size());
+    return file.good();
+}
+
+bool input_movie::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const size_t header_size = 48;
+    size_t offset = 0;
+    bool overrun = false;
+    auto get = [&](uint8_t bytes)
+    {
+        uint64_t value = 0;
+        if (offset + bytes > data.size())
+        {
+            overrun = true;
+            return value;
+        }
+        for (uint8_t i = 0; i < bytes; i++)
+        {
+            value |= (uint64_t)data[offset++] << (i * 8);
+        }
+        return value;
+    };
+    auto get_length = [&]()
+    {
+        uint64_t value = 0;
+        for (uint8_t shift = 0; shift < 64; shift += 7)
+        {
+            if (offset >= data.size())
+                break;
+            uint8_t byte = data[offset++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        overrun = true;
+        return value;
+    };
+
+    if (data.size() < header_size || data[0] != 'C' || data[1] != '8' || data[2] != 'M' || data[3] != 'V')
+        return false;
+    offset = 4;
+    if (get(2) != version)
+        return false;
+
+    rom_hash = get(8);
+    profile = (uint8_t)get(1);
+    timing = (uint8_t)get(1);
+    IPS = (uint32_t)get(4);
+    seed = (uint32_t)get(4);
+    frames = (uint32_t)get(4);
+    final_instructions = get(8);
+    final_hash = get(8);
+    uint32_t count = (uint32_t)get(4);
+
+    changes.clear();
+    uint32_t last_frame = 0;
+    uint64_t last_instruction = 0;
+    for (uint32_t i = 0; i < count && !overrun; i++)
+    {
+        change input;
+        input.frame = last_frame + (uint32_t)get_length();
+        input.instruction = last_instruction + get_length();
+        input.keys = (uint16_t)get(2);
+        changes.push_back(input);
+        last_frame = input.frame;
+        last_instruction = input.instruction;
+    }
+    if (overrun || profile >= chip8_core::profile_count)
+        return false;
+
+    frame = 0;
+    next = 0;
+    keys = 0;
+    desynced = false;
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Core.h"
+
+// Keypad changes of a session from power on, with the settings it ran with, so a
+// replay reproduces it bit for bit. Only frames where the keys change are stored.
+class input_movie
+{
+public:
+    static const uint16_t version = 1;
+
+    // Recording. begin() must come right after the ROM is loaded, and record()
+    // before every frame with the keys that frame runs with.
+    void begin(const chip8_core& emulator);
+    void record(const chip8_core& emulator);
+    void end(const chip8_core& emulator);
+
+    // Replay. setup() loads the ROM with the recorded settings, then play_frame()
+    // runs one frame at a time until it returns false at the end or on a desync.
+    bool setup(chip8_core& emulator, const std::string& game);
+    bool play_frame(chip8_core& emulator);
+    bool finished() const { return frame == frames; }
+    uint32_t position() const { return frame; }
+    bool matches(const chip8_core& emulator) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // Settings and results of the recorded session
+    uint64_t rom_hash = 0;
+    uint8_t profile = 0;
+    uint8_t timing = 0;
+    uint32_t IPS = 0;
+    uint32_t seed = 0;
+    uint32_t frames = 0;
+    uint64_t final_instructions = 0;
+    uint64_t final_hash = 0;
+
+    size_t events() const { return changes.size(); }
+    bool desynced = false; // An instruction count did not match the recording
+
+private:
+    struct change
+    {
+        uint32_t frame;        // Frame the keys were first held on
+        uint64_t instruction;  // Instructions run before that frame
+        uint16_t keys;         // Bit N for key N
+    };
+    std::vector<change> changes;
+
+    // Position while recording or replaying
+    uint32_t frame = 0;
+    size_t next = 0;
+    uint16_t keys = 0;
+};
+
+#endif
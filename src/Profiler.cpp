@@ -0,0 +1,88 @@
+#include "Profiler.h"
+
+#ifdef CHIP8_PROFILER
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+profile_report::profile_report(const chip8_core& emulator)
+{
+    instructions = 0;
+    for (uint8_t i = 0; i < chip8_core::op_count; i++)
+    {
+        operations[i] = emulator.profile.operations[i];
+        instructions += operations[i];
+    }
+    idle = emulator.idle_instructions;
+    halted = emulator.halted_instructions;
+    draw_ns = emulator.profile.draw_ns;
+
+    for (uint16_t address = 0; address < 4096; address++)
+    {
+        if (emulator.profile.addresses[address] == 0)
+            continue;
+        uint16_t opcode = (emulator.memory[address] << 8) | emulator.memory[(address + 1) & 0xFFF];
+        hot_spots.push_back({ address, opcode, chip8_core::dispatch_table[opcode], emulator.profile.addresses[address] });
+    }
+    std::stable_sort(hot_spots.begin(), hot_spots.end(),
+        [](const hot_spot& a, const hot_spot& b) { return a.count > b.count; });
+}
+
+std::string profile_report::json(const std::string& game) const
+{
+    std::string out;
+    char line[256];
+    auto escaped = [](const std::string& text)
+    {
+        std::string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    };
+
+    out += "{\n";
+    out += "    \"rom\": \"" + escaped(game) + "\",\n";
+    snprintf(line, sizeof(line),
+        "    \"instructions\": %llu,\n    \"idle_instructions\": %llu,\n    \"halted_instructions\": %llu,\n    \"draw_ns\": %llu,\n",
+        (unsigned long long)instructions, (unsigned long long)idle, (unsigned long long)halted, (unsigned long long)draw_ns);
+    out += line;
+
+    // Classes that never ran are left out
+    out += "    \"operations\": {";
+    bool first = true;
+    for (uint8_t i = 0; i < chip8_core::op_count; i++)
+    {
+        if (operations[i] == 0)
+            continue;
+        snprintf(line, sizeof(line), "%s\n        \"%s\": %llu", first ? "" : ",",
+            chip8_core::operation_names[i], (unsigned long long)operations[i]);
+        out += line;
+        first = false;
+    }
+    out += "\n    },\n";
+
+    out += "    \"addresses\": [";
+    for (size_t i = 0; i < hot_spots.size(); i++)
+    {
+        const hot_spot& spot = hot_spots[i];
+        snprintf(line, sizeof(line), "%s\n        { \"address\": \"%03X\", \"opcode\": \"%04X\", \"class\": \"%s\", \"count\": %llu }",
+            i == 0 ? "" : ",", spot.address, spot.opcode, chip8_core::operation_names[spot.operation], (unsigned long long)spot.count);
+        out += line;
+    }
+    out += "\n    ]\n}\n";
+    return out;
+}
+
+bool profile_report::save(const std::string& path, const std::string& game) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+    file << json(game);
+    return file.good();
+}
+#endif
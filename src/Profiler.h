@@ -0,0 +1,38 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Core.h"
+
+#ifdef CHIP8_PROFILER
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Summary of a core's execution profile, for the launcher's panel and a JSON export.
+// Only built with CHIP8_PROFILER, like the counters it reads.
+class profile_report
+{
+public:
+    explicit profile_report(const chip8_core& emulator);
+
+    struct hot_spot
+    {
+        uint16_t address;
+        uint16_t opcode;   // As it is in memory now
+        uint8_t operation;
+        uint64_t count;
+    };
+    std::vector<hot_spot> hot_spots; // Every address that ran, most run first
+
+    uint64_t operations[chip8_core::op_count];
+    uint64_t instructions; // Executed, not counting idle or halted slots
+    uint64_t idle;         // Slots skipped in idle loops and the display wait
+    uint64_t halted;       // Slots spent waiting on FX0A
+    uint64_t draw_ns;
+
+    std::string json(const std::string& game) const;
+    bool save(const std::string& path, const std::string& game) const;
+};
+#endif
+
+#endif
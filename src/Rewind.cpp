@@ -0,0 +1,203 @@
+#include <chrono>
+#include "Rewind.h"
+
+rewind_buffer::rewind_buffer(size_t capacity, uint32_t keyframe_interval)
+{
+    ring.assign(capacity, 0);
+    interval = keyframe_interval > 0 ? keyframe_interval : 1;
+    encoded_frames = 0;
+    encode_ns = 0;
+    restored_frames = 0;
+    restore_ns = 0;
+    clear();
+}
+
+void rewind_buffer::clear()
+{
+    entries.clear();
+    head = 0;
+    used = 0;
+    base.clear();
+}
+
+size_t rewind_buffer::memory_used() const
+{
+    return ring.size() + entries.size() * sizeof(entry) + key.capacity() + base.capacity() + current.capacity() + encoded.capacity();
+}
+
+void rewind_buffer::record(const chip8_core& emulator)
+{
+    auto start = std::chrono::steady_clock::now();
+    emulator.save_state(snapshot);
+    emulator.serialize(snapshot, current);
+    if (base.empty())
+        base = current;
+
+    uint32_t key_distance = entries.empty() ? 0 : entries.back().key_distance + 1;
+    if (key_distance >= interval)
+        key_distance = 0;
+
+    // A delta whose keyframe had to be dropped to make room is stored as a keyframe instead
+    while (true)
+    {
+        if (key_distance == 0)
+        {
+            key = current;
+            encode(current, base, encoded);
+        }
+        else
+            encode(current, key, encoded);
+
+        if (make_room(encoded.size()) || key_distance == 0)
+            break;
+        key_distance = 0;
+    }
+
+    if (encoded.size() <= ring.size())
+    {
+        std::copy(encoded.begin(), encoded.end(), ring.begin() + head);
+        entries.push_back({ head, (uint32_t)encoded.size(), key_distance });
+        head += (uint32_t)encoded.size();
+        used += encoded.size();
+    }
+
+    encoded_frames++;
+    encode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool rewind_buffer::rewind(chip8_core& emulator)
+{
+    if (entries.size() < 2)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // The newest frame is the one on screen, so it is dropped and the one before restored
+    entry newest = entries.back();
+    entries.pop_back();
+    head = newest.offset;
+    used -= newest.size;
+
+    const entry& previous = entries.back();
+    if (newest.key_distance == 0)
+    {
+        const entry& keyframe = entries[entries.size() - 1 - previous.key_distance];
+        decode(&ring[keyframe.offset], keyframe.size, base, key);
+    }
+    if (previous.key_distance == 0)
+        current = key;
+    else
+        decode(&ring[previous.offset], previous.size, key, current);
+
+    if (!emulator.deserialize(current, snapshot))
+        return false;
+    emulator.load_state(snapshot);
+
+    restored_frames++;
+    restore_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool rewind_buffer::make_room(size_t size)
+{
+    // Returns false if everything had to go, including the newest keyframe
+    if (size > ring.size())
+    {
+        clear();
+        return false;
+    }
+
+    // Frames are never split, so one that does not fit before the end starts over at zero
+    if (head + size > ring.size())
+        head = 0;
+
+    while (!entries.empty())
+    {
+        const entry& oldest = entries.front();
+        if (oldest.offset >= head + size || oldest.offset + oldest.size <= head)
+            break;
+        drop_oldest();
+    }
+    return !entries.empty();
+}
+
+void rewind_buffer::drop_oldest()
+{
+    // Deltas are useless without their keyframe, so the whole group goes
+    do
+    {
+        used -= entries.front().size;
+        entries.pop_front();
+    } while (!entries.empty() && entries.front().key_distance != 0);
+}
+
+static void put_length(std::vector<uint8_t>& out, size_t value)
+{
+    // Seven bits per byte, the top bit set on all but the last
+    while (value >= 0x80)
+    {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static size_t get_length(const uint8_t*& data)
+{
+    size_t value = 0;
+    uint8_t shift = 0;
+    while (*data & 0x80)
+    {
+        value |= (size_t)(*data++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= (size_t)*data++ << shift;
+    return value;
+}
+
+void rewind_buffer::encode(const std::vector<uint8_t>& data, const std::vector<uint8_t>& base, std::vector<uint8_t>& out)
+{
+    // Runs of bytes equal to the base are stored as a length, the rest as XORed literals:
+    // <equal run> <literal run> <literals>..., repeated to the end
+    out.clear();
+    size_t size = data.size();
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t equal_start = i;
+        while (i < size && data[i] == base[i])
+        {
+            i++;
+        }
+
+        // A single equal byte costs less inside a literal run than as a run of its own
+        size_t literal_start = i;
+        while (i < size && (data[i] != base[i] || (i + 1 < size && data[i + 1] != base[i + 1])))
+        {
+            i++;
+        }
+
+        put_length(out, literal_start - equal_start);
+        put_length(out, i - literal_start);
+        for (size_t j = literal_start; j < i; j++)
+        {
+            out.push_back(data[j] ^ base[j]);
+        }
+    }
+}
+
+void rewind_buffer::decode(const uint8_t* data, size_t size, const std::vector<uint8_t>& base, std::vector<uint8_t>& out)
+{
+    out = base;
+    const uint8_t* end = data + size;
+    size_t i = 0;
+    while (data < end)
+    {
+        i += get_length(data);
+        size_t literals = get_length(data);
+        for (size_t j = 0; j < literals; j++)
+        {
+            out[i++] ^= *data++;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "Core.h"
+
+// Per frame history of a chip8_core for rewinding. Each frame's serialized state is
+// XORed against the latest keyframe and run-length encoded, so unchanged bytes cost
+// almost nothing. Frames live in a fixed size ring that drops the oldest keyframe and
+// its deltas when it fills up.
+class rewind_buffer
+{
+public:
+    explicit rewind_buffer(size_t capacity = 16 * 1024 * 1024, uint32_t keyframe_interval = 30);
+
+    // Stores the state after a frame
+    void record(const chip8_core& emulator);
+    // Restores the frame before the latest one and forgets the latest, false once only one is left
+    bool rewind(chip8_core& emulator);
+    void clear();
+
+    size_t frames() const { return entries.size(); }
+    size_t bytes_used() const { return used; } // Encoded frames, excluding the index
+    size_t memory_used() const; // Ring, index and working buffers
+    size_t capacity() const { return ring.size(); }
+
+    // Time spent encoding and restoring frames
+    uint64_t encoded_frames;
+    uint64_t encode_ns;
+    uint64_t restored_frames;
+    uint64_t restore_ns;
+
+private:
+    struct entry
+    {
+        uint32_t offset;       // Start in the ring
+        uint32_t size;         // Encoded bytes
+        uint32_t key_distance; // Frames since its keyframe, zero for a keyframe
+    };
+
+    std::vector<uint8_t> ring;
+    uint32_t head; // Where the next frame is written
+    size_t used;
+    std::deque<entry> entries;
+    uint32_t interval;
+
+    std::vector<uint8_t> key;     // Serialized keyframe of the newest entry
+    std::vector<uint8_t> base;    // First frame after a clear, keyframes are encoded against it so the ROM costs nothing
+    std::vector<uint8_t> current; // Serialized frame being stored or restored
+    std::vector<uint8_t> encoded;
+    chip8_core::state snapshot;
+
+    bool make_room(size_t size);
+    void drop_oldest();
+    static void encode(const std::vector<uint8_t>& data, const std::vector<uint8_t>& base, std::vector<uint8_t>& out);
+    static void decode(const uint8_t* data, size_t size, const std::vector<uint8_t>& base, std::vector<uint8_t>& out);
+};
+
+#endif
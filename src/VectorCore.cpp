@@ -0,0 +1,869 @@
+#include <bitset>
+#include <fstream>
+#include "VectorCore.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// One register holds 32 lanes of bytes or 16 lanes of words. Masks are all ones
+// for a lane that takes part and zero otherwise.
+typedef __m256i byte_vector;
+typedef __m256i word_vector;
+
+static inline byte_vector load8(const uint8_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline word_vector load16(const uint16_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void store8(uint8_t* p, byte_vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline void store16(uint16_t* p, word_vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline byte_vector splat8(uint8_t c) { return _mm256_set1_epi8((char)c); }
+static inline word_vector splat16(uint16_t c) { return _mm256_set1_epi16((short)c); }
+
+static inline __m256i vand(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+static inline __m256i vor(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+static inline __m256i vxor(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+static inline __m256i vandnot(__m256i a, __m256i b) { return _mm256_andnot_si256(a, b); } // ~a & b
+static inline __m256i select(__m256i m, __m256i a, __m256i b) { return _mm256_blendv_epi8(b, a, m); }
+static inline bool any(__m256i m) { return !_mm256_testz_si256(m, m); }
+
+static inline byte_vector add8(byte_vector a, byte_vector b) { return _mm256_add_epi8(a, b); }
+static inline byte_vector sub8(byte_vector a, byte_vector b) { return _mm256_sub_epi8(a, b); }
+static inline byte_vector eq8(byte_vector a, byte_vector b) { return _mm256_cmpeq_epi8(a, b); }
+static inline byte_vector max8(byte_vector a, byte_vector b) { return _mm256_max_epu8(a, b); }
+static inline byte_vector decrement8(byte_vector a) { return _mm256_subs_epu8(a, splat8(1)); } // Stops at zero
+static inline byte_vector shr8(byte_vector a) { return vand(_mm256_srli_epi16(a, 1), splat8(0x7F)); }
+static inline byte_vector top_bit8(byte_vector a) { return vand(_mm256_srli_epi16(a, 7), splat8(0x01)); }
+static inline uint32_t count_lanes(byte_vector m) { return (uint32_t)std::bitset<32>((uint32_t)_mm256_movemask_epi8(m)).count(); }
+
+static inline word_vector add16(word_vector a, word_vector b) { return _mm256_add_epi16(a, b); }
+static inline word_vector eq16(word_vector a, word_vector b) { return _mm256_cmpeq_epi16(a, b); }
+static inline word_vector min16(word_vector a, word_vector b) { return _mm256_min_epu16(a, b); }
+static inline word_vector mul16(word_vector a, uint16_t c) { return _mm256_mullo_epi16(a, splat16(c)); }
+
+// Bytes 0-15 or 16-31 as words, zero extended for values and sign extended for masks
+static inline word_vector widen_low(byte_vector a) { return _mm256_cvtepu8_epi16(_mm256_castsi256_si128(a)); }
+static inline word_vector widen_high(byte_vector a) { return _mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1)); }
+static inline word_vector widen_mask_low(byte_vector m) { return _mm256_cvtepi8_epi16(_mm256_castsi256_si128(m)); }
+static inline word_vector widen_mask_high(byte_vector m) { return _mm256_cvtepi8_epi16(_mm256_extracti128_si256(m, 1)); }
+static inline byte_vector narrow_mask(word_vector low, word_vector high)
+{
+    // Packing works within each 128 bit half, so the middle quarters are swapped back
+    return _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+}
+
+static inline uint16_t lowest_lane16(word_vector a)
+{
+    __m128i m = _mm_min_epu16(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+    return (uint16_t)_mm_extract_epi16(_mm_minpos_epu16(m), 0);
+}
+
+#else
+
+// Portable fallback with the same lanes, which compilers vectorize with whatever they have
+struct byte_vector { uint8_t lane[32]; };
+struct word_vector { uint16_t lane[16]; };
+
+static inline byte_vector load8(const uint8_t* p) { byte_vector v; for (int i = 0; i < 32; i++) v.lane[i] = p[i]; return v; }
+static inline word_vector load16(const uint16_t* p) { word_vector v; for (int i = 0; i < 16; i++) v.lane[i] = p[i]; return v; }
+static inline void store8(uint8_t* p, byte_vector v) { for (int i = 0; i < 32; i++) p[i] = v.lane[i]; }
+static inline void store16(uint16_t* p, word_vector v) { for (int i = 0; i < 16; i++) p[i] = v.lane[i]; }
+static inline byte_vector splat8(uint8_t c) { byte_vector v; for (int i = 0; i < 32; i++) v.lane[i] = c; return v; }
+static inline word_vector splat16(uint16_t c) { word_vector v; for (int i = 0; i < 16; i++) v.lane[i] = c; return v; }
+
+template <typename T> static inline T vand(T a, T b) { for (auto& l : a.lane) l &= b.lane[&l - a.lane]; return a; }
+template <typename T> static inline T vor(T a, T b) { for (auto& l : a.lane) l |= b.lane[&l - a.lane]; return a; }
+template <typename T> static inline T vxor(T a, T b) { for (auto& l : a.lane) l ^= b.lane[&l - a.lane]; return a; }
+template <typename T> static inline T vandnot(T a, T b) { for (auto& l : a.lane) l = ~l & b.lane[&l - a.lane]; return a; }
+template <typename T> static inline T select(T m, T a, T b) { return vor(vand(m, a), vandnot(m, b)); }
+template <typename T> static inline bool any(T m) { for (auto l : m.lane) if (l) return true; return false; }
+
+static inline byte_vector add8(byte_vector a, byte_vector b) { for (int i = 0; i < 32; i++) a.lane[i] += b.lane[i]; return a; }
+static inline byte_vector sub8(byte_vector a, byte_vector b) { for (int i = 0; i < 32; i++) a.lane[i] -= b.lane[i]; return a; }
+static inline byte_vector eq8(byte_vector a, byte_vector b) { for (int i = 0; i < 32; i++) a.lane[i] = a.lane[i] == b.lane[i] ? 0xFF : 0; return a; }
+static inline byte_vector max8(byte_vector a, byte_vector b) { for (int i = 0; i < 32; i++) if (b.lane[i] > a.lane[i]) a.lane[i] = b.lane[i]; return a; }
+static inline byte_vector decrement8(byte_vector a) { for (int i = 0; i < 32; i++) if (a.lane[i] > 0) a.lane[i]--; return a; }
+static inline byte_vector shr8(byte_vector a) { for (int i = 0; i < 32; i++) a.lane[i] >>= 1; return a; }
+static inline byte_vector top_bit8(byte_vector a) { for (int i = 0; i < 32; i++) a.lane[i] >>= 7; return a; }
+static inline uint32_t count_lanes(byte_vector m) { uint32_t n = 0; for (int i = 0; i < 32; i++) n += m.lane[i] != 0; return n; }
+
+static inline word_vector add16(word_vector a, word_vector b) { for (int i = 0; i < 16; i++) a.lane[i] += b.lane[i]; return a; }
+static inline word_vector eq16(word_vector a, word_vector b) { for (int i = 0; i < 16; i++) a.lane[i] = a.lane[i] == b.lane[i] ? 0xFFFF : 0; return a; }
+static inline word_vector min16(word_vector a, word_vector b) { for (int i = 0; i < 16; i++) if (b.lane[i] < a.lane[i]) a.lane[i] = b.lane[i]; return a; }
+static inline word_vector mul16(word_vector a, uint16_t c) { for (int i = 0; i < 16; i++) a.lane[i] *= c; return a; }
+
+static inline word_vector widen_low(byte_vector a) { word_vector v; for (int i = 0; i < 16; i++) v.lane[i] = a.lane[i]; return v; }
+static inline word_vector widen_high(byte_vector a) { word_vector v; for (int i = 0; i < 16; i++) v.lane[i] = a.lane[i + 16]; return v; }
+static inline word_vector widen_mask_low(byte_vector m) { word_vector v; for (int i = 0; i < 16; i++) v.lane[i] = m.lane[i] ? 0xFFFF : 0; return v; }
+static inline word_vector widen_mask_high(byte_vector m) { word_vector v; for (int i = 0; i < 16; i++) v.lane[i] = m.lane[i + 16] ? 0xFFFF : 0; return v; }
+static inline byte_vector narrow_mask(word_vector low, word_vector high)
+{
+    byte_vector v;
+    for (int i = 0; i < 16; i++)
+    {
+        v.lane[i] = low.lane[i] ? 0xFF : 0;
+        v.lane[i + 16] = high.lane[i] ? 0xFF : 0;
+    }
+    return v;
+}
+
+static inline uint16_t lowest_lane16(word_vector a) { uint16_t n = 0xFFFF; for (int i = 0; i < 16; i++) if (a.lane[i] < n) n = a.lane[i]; return n; }
+
+#endif
+
+chip8_vector::chip8_vector(size_t lanes)
+{
+    count = lanes;
+    width = (lanes + 31) & ~(size_t)31;
+
+    V.assign(16 * width, 0);
+    I.assign(width, 0);
+    PC.assign(width, 0x200);
+    DT.assign(width, 0);
+    ST.assign(width, 0);
+    SP.assign(width, 0);
+    stack.assign(16 * width, 0);
+    remaining.assign(width, 0);
+    mask.assign(width, 0);
+
+    memory.assign(4096 * count, 0);
+    display.assign(32 * count, 0);
+    keys.assign(count, 0);
+    random_seed.assign(count, 0);
+    random_state.assign(count, 0);
+    halted.assign(count, 0);
+    key_register.assign(count, 0);
+    pressed_key.assign(count, -1);
+
+    set_speed(700);
+    select_profile(chip8_core::profile_cosmac_vip);
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        seed(lane, 1);
+    }
+    load(nullptr, 0);
+}
+
+void chip8_vector::select_profile(uint8_t profile)
+{
+    active_quirks = chip8_core::profile_quirks[profile < chip8_core::profile_count ? profile : chip8_core::profile_cosmac_vip];
+}
+
+bool chip8_vector::load(const std::string& game)
+{
+    std::ifstream ifs(game, std::ifstream::binary);
+    if (!ifs.is_open())
+        return false;
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    return load(data.data(), data.size());
+}
+
+bool chip8_vector::load(const uint8_t* data, size_t size)
+{
+    // Anything past the end of memory is dropped, as in chip8_core
+    if (size > 4096 - 0x200)
+        size = 4096 - 0x200;
+    image.assign(4096, 0);
+    for (uint8_t i = 0; i < 80; i++)
+    {
+        image[i + 0x50] = chip8_core::font[i];
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        image[i + 0x200] = data[i];
+    }
+
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        reset(lane);
+    }
+    for (uint16_t i = 0; i < 4096; i++)
+    {
+        written[i] = false;
+    }
+
+    group_count = 0;
+    lane_instructions = 0;
+    split_count = 0;
+    trap_count = 0;
+    stack_faults = 0;
+    return true;
+}
+
+void chip8_vector::reset(size_t lane)
+{
+    // Puts one lane back where load leaves it while the others keep their state
+    std::copy(image.begin(), image.end(), &memory[lane * 4096]);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        V[i * width + lane] = 0;
+        stack[i * width + lane] = 0;
+    }
+    I[lane] = 0;
+    PC[lane] = 0x200;
+    DT[lane] = 0;
+    ST[lane] = 0;
+    SP[lane] = 0;
+    remaining[lane] = 0;
+    std::fill(&display[lane * 32], &display[lane * 32] + 32, 0);
+    keys[lane] = 0;
+    halted[lane] = 0;
+    key_register[lane] = 0;
+    pressed_key[lane] = -1;
+    random_state[lane] = random_seed[lane];
+}
+
+void chip8_vector::set_speed(uint32_t ips)
+{
+    IPS = ips;
+    speed_remainder = 0;
+    next_budget();
+}
+
+void chip8_vector::next_budget()
+{
+    speed_remainder += IPS;
+    IPF = speed_remainder / 60;
+    speed_remainder %= 60;
+    if (IPF > 0xFFFF)
+        IPF = 0xFFFF;
+}
+
+void chip8_vector::seed(size_t lane, uint32_t value)
+{
+    random_seed[lane] = value != 0 ? value : 0x9E3779B9;
+    random_state[lane] = random_seed[lane];
+}
+
+void chip8_vector::set_keys(size_t lane, uint16_t value)
+{
+    keys[lane] = value;
+}
+
+bool chip8_vector::pixel(size_t lane, uint8_t x, uint8_t y) const
+{
+    return (display[lane * 32 + (y & 31)] >> (63 - (x & 63))) & 1;
+}
+
+uint64_t chip8_vector::framebuffer_hash(size_t lane) const
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (uint8_t x = 0; x < 64; x++)
+    {
+        for (uint8_t y = 0; y < 32; y++)
+        {
+            hash = (hash ^ (uint64_t)pixel(lane, x, y)) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+void chip8_vector::run_frame()
+{
+    // Halted lanes poll their keys once at the start of the frame, like chip8_core::execute
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        remaining[lane] = (uint16_t)IPF;
+        if (halted[lane] && IPF > 0)
+        {
+            poll_key(lane);
+            remaining[lane] = halted[lane] ? 0 : (uint16_t)(IPF - 1);
+        }
+    }
+
+    // Issues the lowest PC first, so lanes that skipped ahead wait for the others to catch up
+    uint16_t pc;
+    while (lowest_pc(pc))
+    {
+        size_t leader = build_group(pc);
+        uint16_t opcode = fetch(leader, pc);
+        if (written[pc & 0xFFF] || written[(pc + 1) & 0xFFF])
+            split_group(leader, pc);
+        if (!idle_loop(leader, pc, opcode))
+            execute(leader, opcode);
+        group_count++;
+    }
+
+    tick_timers();
+    next_budget();
+}
+
+bool chip8_vector::lowest_pc(uint16_t& pc) const
+{
+    word_vector zero = splat16(0);
+    word_vector lowest = splat16(0xFFFF);
+    word_vector busy = zero;
+    for (size_t i = 0; i < width; i += 16)
+    {
+        word_vector done = eq16(load16(&remaining[i]), zero);
+        lowest = min16(lowest, vor(load16(&PC[i]), done));
+        busy = vor(busy, vandnot(done, splat16(0xFFFF)));
+    }
+    pc = lowest_lane16(lowest);
+    return any(busy);
+}
+
+size_t chip8_vector::build_group(uint16_t pc)
+{
+    // Marks every lane at pc with budget left, then takes its slot and steps its PC
+    // the way chip8_core::execute does before running the handler
+    word_vector zero = splat16(0);
+    word_vector target = splat16(pc);
+    word_vector next = splat16(pc + 2);
+    size_t leader = width;
+    for (size_t i = 0; i < width; i += 32)
+    {
+        word_vector low = vandnot(eq16(load16(&remaining[i]), zero), eq16(load16(&PC[i]), target));
+        word_vector high = vandnot(eq16(load16(&remaining[i + 16]), zero), eq16(load16(&PC[i + 16]), target));
+        byte_vector group = narrow_mask(low, high);
+        store8(&mask[i], group);
+        if (!any(group))
+            continue;
+
+        store16(&remaining[i], add16(load16(&remaining[i]), low));
+        store16(&remaining[i + 16], add16(load16(&remaining[i + 16]), high));
+        store16(&PC[i], select(low, next, load16(&PC[i])));
+        store16(&PC[i + 16], select(high, next, load16(&PC[i + 16])));
+        lane_instructions += count_lanes(group);
+
+        if (leader == width)
+        {
+            leader = i;
+            while (mask[leader] == 0)
+            {
+                leader++;
+            }
+        }
+    }
+    group_first = leader & ~(size_t)31;
+    return leader;
+}
+
+uint16_t chip8_vector::fetch(size_t lane, uint16_t pc) const
+{
+    const uint8_t* ram = &memory[lane * 4096];
+    return (ram[pc & 0xFFF] << 8) | ram[(pc + 1) & 0xFFF];
+}
+
+void chip8_vector::split_group(size_t leader, uint16_t pc)
+{
+    // Lanes have stored to this address, so only those holding the leader's opcode stay
+    uint16_t opcode = fetch(leader, pc);
+    bool split = false;
+    for (size_t lane = leader + 1; lane < count; lane++)
+    {
+        if (mask[lane] != 0 && fetch(lane, pc) != opcode)
+        {
+            mask[lane] = 0;
+            remaining[lane]++;
+            PC[lane] = pc;
+            lane_instructions--;
+            split = true;
+        }
+    }
+    if (split)
+        split_count++;
+}
+
+template <typename action>
+void chip8_vector::for_each_lane(size_t leader, action run)
+{
+    for (size_t lane = leader; lane < count; lane++)
+    {
+        if (mask[lane] != 0)
+            run(lane);
+    }
+}
+
+bool chip8_vector::idle_loop(size_t leader, uint16_t pc, uint16_t opcode)
+{
+    // Lanes spinning on a self jump or on the delay timer can only leave the loop next
+    // frame, so they give up the rest of this one like chip8_core's superinstructions
+    for (uint16_t i = 0; i < 6; i++)
+    {
+        if (written[(pc + i) & 0xFFF])
+            return false;
+    }
+
+    if (opcode == (0x1000 | pc))
+    {
+        for_each_lane(leader, [&](size_t lane)
+        {
+            PC[lane] = pc;
+            remaining[lane] = 0;
+        });
+        return true;
+    }
+
+    // FX07 3X00 1NNN back to FX07, where PC ends wherever the last iteration would stop
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    if ((opcode & 0xF0FF) == 0xF007 && fetch(leader, pc + 2) == (0x3000 | (x << 8)) && fetch(leader, pc + 4) == (0x1000 | pc))
+    {
+        copy_timer(x, chip8_core::op_get_delay_timer);
+        for_each_lane(leader, [&](size_t lane)
+        {
+            if (DT[lane] != 0)
+            {
+                PC[lane] = pc + ((remaining[lane] + 1) % 3) * 2;
+                remaining[lane] = 0;
+            }
+        });
+        return true;
+    }
+    return false;
+}
+
+void chip8_vector::execute(size_t leader, uint16_t opcode)
+{
+    uint16_t nnn = opcode & 0x0FFF;
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    uint8_t n = opcode & 0x000F;
+    uint8_t nn = opcode & 0x00FF;
+
+    uint8_t operation = chip8_core::dispatch_table[opcode];
+    switch (operation)
+    {
+        case chip8_core::op_set_vx: set_register(x, nn); break;
+        case chip8_core::op_add_vx: add_register(x, nn); break;
+        case chip8_core::op_logical_set:
+        case chip8_core::op_logical_OR:
+        case chip8_core::op_logical_AND:
+        case chip8_core::op_logical_XOR:
+            logical(x, y, operation);
+            break;
+        case chip8_core::op_logical_add:
+        case chip8_core::op_logical_subtract:
+        case chip8_core::op_logical_subtract_reverse:
+        case chip8_core::op_shift_right:
+        case chip8_core::op_shift_left:
+            arithmetic(x, y, operation);
+            break;
+        case chip8_core::op_equal_skip:
+        case chip8_core::op_unequal_skip:
+        case chip8_core::op_equal_register_skip:
+        case chip8_core::op_unequal_register_skip:
+            skip(x, y, nn, operation);
+            break;
+        case chip8_core::op_set_index: set_index(nnn); break;
+        case chip8_core::op_add_index: add_index(x); break;
+        case chip8_core::op_point_font: point_font(x); break;
+        case chip8_core::op_jump: jump(nnn); break;
+        case chip8_core::op_offset_jump: offset_jump(nnn, active_quirks.jumping ? x : 0); break;
+        case chip8_core::op_get_delay_timer:
+        case chip8_core::op_set_delay_timer:
+        case chip8_core::op_set_sound_timer:
+            copy_timer(x, operation);
+            break;
+
+        case chip8_core::op_clear_screen:
+            for_each_lane(leader, [&](size_t lane) { clear_screen(lane); });
+            break;
+        case chip8_core::op_call_subroutine:
+            for_each_lane(leader, [&](size_t lane) { call_subroutine(lane, nnn); });
+            break;
+        case chip8_core::op_return_from_subroutine:
+            for_each_lane(leader, [&](size_t lane) { return_from_subroutine(lane); });
+            break;
+        case chip8_core::op_random:
+            for_each_lane(leader, [&](size_t lane) { random(lane, x, nn); });
+            break;
+        case chip8_core::op_draw:
+            for_each_lane(leader, [&](size_t lane) { draw(lane, x, y, n); });
+            break;
+        case chip8_core::op_skip_if_key:
+        case chip8_core::op_skip_if_not_key:
+            for_each_lane(leader, [&](size_t lane) { skip_key(lane, x, operation == chip8_core::op_skip_if_key); });
+            break;
+        case chip8_core::op_decimal_conversion:
+            for_each_lane(leader, [&](size_t lane) { decimal_conversion(lane, x); });
+            break;
+        case chip8_core::op_store_memory:
+            for_each_lane(leader, [&](size_t lane) { store_memory(lane, x); });
+            break;
+        case chip8_core::op_load_memory:
+            for_each_lane(leader, [&](size_t lane) { load_memory(lane, x); });
+            break;
+        case chip8_core::op_get_key:
+            for_each_lane(leader, [&](size_t lane) { get_key(lane, x); });
+            break;
+
+        default:
+            // Unknown opcodes such as 0NNN are counted and otherwise ignored
+            for_each_lane(leader, [&](size_t lane) { trap_count++; });
+            break;
+    }
+}
+
+void chip8_vector::tick_timers()
+{
+    for (size_t i = 0; i < width; i += 32)
+    {
+        store8(&DT[i], decrement8(load8(&DT[i])));
+        store8(&ST[i], decrement8(load8(&ST[i])));
+    }
+}
+
+void chip8_vector::set_register(uint8_t x, uint8_t nn)
+{
+    uint8_t* Vx = &V[x * width];
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+        store8(&Vx[i], select(group, splat8(nn), load8(&Vx[i])));
+    }
+}
+
+void chip8_vector::add_register(uint8_t x, uint8_t nn)
+{
+    uint8_t* Vx = &V[x * width];
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+        byte_vector vx = load8(&Vx[i]);
+        store8(&Vx[i], select(group, add8(vx, splat8(nn)), vx));
+    }
+}
+
+void chip8_vector::logical(uint8_t x, uint8_t y, uint8_t operation)
+{
+    // 8XY0 to 8XY3
+    uint8_t* Vx = &V[x * width];
+    uint8_t* Vy = &V[y * width];
+    uint8_t* VF = &V[0xF * width];
+    bool reset_flag = operation != chip8_core::op_logical_set && active_quirks.logic;
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+
+        byte_vector vx = load8(&Vx[i]);
+        byte_vector vy = load8(&Vy[i]);
+        byte_vector result = vy;
+        if (operation == chip8_core::op_logical_OR) result = vor(vx, vy);
+        if (operation == chip8_core::op_logical_AND) result = vand(vx, vy);
+        if (operation == chip8_core::op_logical_XOR) result = vxor(vx, vy);
+        store8(&Vx[i], select(group, result, vx));
+        if (reset_flag)
+            store8(&VF[i], select(group, splat8(0), load8(&VF[i])));
+    }
+}
+
+void chip8_vector::arithmetic(uint8_t x, uint8_t y, uint8_t operation)
+{
+    // 8XY4 to 8XYE, VF is written after VX so it wins when X is F
+    uint8_t* Vx = &V[x * width];
+    uint8_t* Vy = &V[y * width];
+    uint8_t* VF = &V[0xF * width];
+    byte_vector one = splat8(1);
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+
+        byte_vector vx = load8(&Vx[i]);
+        byte_vector vy = load8(&Vy[i]);
+        byte_vector source = active_quirks.shifting ? vx : vy;
+        byte_vector result;
+        byte_vector flag;
+        switch (operation)
+        {
+            case chip8_core::op_logical_add:
+                result = add8(vx, vy);
+                flag = vandnot(eq8(max8(vx, result), result), one); // Wrapped below VX
+                break;
+            case chip8_core::op_logical_subtract:
+                result = sub8(vx, vy);
+                flag = vand(eq8(max8(vx, vy), vx), one);
+                break;
+            case chip8_core::op_logical_subtract_reverse:
+                result = sub8(vy, vx);
+                flag = vand(eq8(max8(vx, vy), vy), one);
+                break;
+            case chip8_core::op_shift_right:
+                result = shr8(source);
+                flag = vand(source, one);
+                break;
+            default:
+                result = add8(source, source);
+                flag = top_bit8(source);
+                break;
+        }
+        store8(&Vx[i], select(group, result, vx));
+        store8(&VF[i], select(group, flag, load8(&VF[i])));
+    }
+}
+
+void chip8_vector::skip(uint8_t x, uint8_t y, uint8_t nn, uint8_t operation)
+{
+    // PC already points past the skip, taken lanes step over one more instruction
+    uint8_t* Vx = &V[x * width];
+    uint8_t* Vy = &V[y * width];
+    bool register_compare = operation == chip8_core::op_equal_register_skip || operation == chip8_core::op_unequal_register_skip;
+    bool unequal = operation == chip8_core::op_unequal_skip || operation == chip8_core::op_unequal_register_skip;
+    word_vector two = splat16(2);
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+
+        byte_vector equal = eq8(load8(&Vx[i]), register_compare ? load8(&Vy[i]) : splat8(nn));
+        byte_vector taken = unequal ? vandnot(equal, group) : vand(equal, group);
+        store16(&PC[i], add16(load16(&PC[i]), vand(widen_mask_low(taken), two)));
+        store16(&PC[i + 16], add16(load16(&PC[i + 16]), vand(widen_mask_high(taken), two)));
+    }
+}
+
+void chip8_vector::set_index(uint16_t nnn)
+{
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+        store16(&I[i], select(widen_mask_low(group), splat16(nnn), load16(&I[i])));
+        store16(&I[i + 16], select(widen_mask_high(group), splat16(nnn), load16(&I[i + 16])));
+    }
+}
+
+void chip8_vector::add_index(uint8_t x)
+{
+    // FX1E, VF is set when I leaves the 12 bit address space
+    uint8_t* Vx = &V[x * width];
+    uint8_t* VF = &V[0xF * width];
+    word_vector zero = splat16(0);
+    word_vector all = splat16(0xFFFF);
+    word_vector high_bits = splat16(0xF000);
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+
+        byte_vector vx = load8(&Vx[i]);
+        word_vector low = select(widen_mask_low(group), add16(load16(&I[i]), widen_low(vx)), load16(&I[i]));
+        word_vector high = select(widen_mask_high(group), add16(load16(&I[i + 16]), widen_high(vx)), load16(&I[i + 16]));
+        store16(&I[i], low);
+        store16(&I[i + 16], high);
+
+        byte_vector overflow = narrow_mask(vandnot(eq16(vand(low, high_bits), zero), all), vandnot(eq16(vand(high, high_bits), zero), all));
+        store8(&VF[i], select(vand(group, overflow), splat8(1), load8(&VF[i])));
+    }
+}
+
+void chip8_vector::point_font(uint8_t x)
+{
+    uint8_t* Vx = &V[x * width];
+    word_vector font = splat16(0x50);
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+
+        byte_vector digit = vand(load8(&Vx[i]), splat8(0x0F));
+        store16(&I[i], select(widen_mask_low(group), add16(mul16(widen_low(digit), 5), font), load16(&I[i])));
+        store16(&I[i + 16], select(widen_mask_high(group), add16(mul16(widen_high(digit), 5), font), load16(&I[i + 16])));
+    }
+}
+
+void chip8_vector::jump(uint16_t nnn)
+{
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+        store16(&PC[i], select(widen_mask_low(group), splat16(nnn), load16(&PC[i])));
+        store16(&PC[i + 16], select(widen_mask_high(group), splat16(nnn), load16(&PC[i + 16])));
+    }
+}
+
+void chip8_vector::offset_jump(uint16_t nnn, uint8_t x)
+{
+    uint8_t* Vx = &V[x * width];
+    word_vector base = splat16(nnn);
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+
+        byte_vector vx = load8(&Vx[i]);
+        store16(&PC[i], select(widen_mask_low(group), add16(base, widen_low(vx)), load16(&PC[i])));
+        store16(&PC[i + 16], select(widen_mask_high(group), add16(base, widen_high(vx)), load16(&PC[i + 16])));
+    }
+}
+
+void chip8_vector::copy_timer(uint8_t x, uint8_t operation)
+{
+    // FX07, FX15 and FX18
+    uint8_t* Vx = &V[x * width];
+    uint8_t* source = operation == chip8_core::op_get_delay_timer ? &DT[0] : Vx;
+    uint8_t* target = Vx;
+    if (operation == chip8_core::op_set_delay_timer) target = &DT[0];
+    if (operation == chip8_core::op_set_sound_timer) target = &ST[0];
+    for (size_t i = group_first; i < width; i += 32)
+    {
+        byte_vector group = load8(&mask[i]);
+        if (!any(group))
+            continue;
+        store8(&target[i], select(group, load8(&source[i]), load8(&target[i])));
+    }
+}
+
+void chip8_vector::clear_screen(size_t lane)
+{
+    std::fill(&display[lane * 32], &display[lane * 32] + 32, 0);
+}
+
+void chip8_vector::call_subroutine(size_t lane, uint16_t nnn)
+{
+    if (SP[lane] == 16)
+    {
+        SP[lane] = 0;
+        stack_faults++;
+    }
+    stack[SP[lane]++ * width + lane] = PC[lane];
+    PC[lane] = nnn;
+}
+
+void chip8_vector::return_from_subroutine(size_t lane)
+{
+    if (SP[lane] == 0)
+    {
+        SP[lane] = 16;
+        stack_faults++;
+    }
+    PC[lane] = stack[--SP[lane] * width + lane];
+}
+
+void chip8_vector::random(size_t lane, uint8_t x, uint8_t nn)
+{
+    uint32_t& state = random_state[lane];
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    V[x * width + lane] = (state >> 24) & nn;
+}
+
+void chip8_vector::draw(size_t lane, uint8_t x, uint8_t y, uint8_t n)
+{
+    if (active_quirks.display_wait && remaining[lane] + 1u != IPF)
+    {
+        // Only the first instruction of a frame may draw, the rest of the frame waits
+        PC[lane] -= 2;
+        remaining[lane] = 0;
+        return;
+    }
+
+    // Each sprite row is shifted into place and XORed with a whole display row
+    uint64_t* rows = &display[lane * 32];
+    const uint8_t* ram = &memory[lane * 4096];
+    uint8_t x_coor = V[x * width + lane] & 63;
+    uint8_t y_coor = V[y * width + lane] & 31;
+    uint16_t index = I[lane];
+    uint8_t collision = 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint64_t sprite = (uint64_t)ram[(index + i) & 0xFFF] << 56;
+        uint64_t bits = sprite >> x_coor;
+        if (active_quirks.wrapping && x_coor != 0)
+            bits |= sprite << (64 - x_coor);
+
+        if (rows[y_coor] & bits)
+            collision = 1;
+        rows[y_coor] ^= bits;
+
+        y_coor++;
+        if (active_quirks.wrapping)
+            y_coor %= 32;
+        else if (y_coor > 31)
+            break;
+    }
+    V[0xF * width + lane] = collision;
+}
+
+void chip8_vector::skip_key(size_t lane, uint8_t x, bool pressed)
+{
+    bool down = (keys[lane] >> (V[x * width + lane] & 0xF)) & 1;
+    if (down == pressed)
+        PC[lane] += 2;
+}
+
+void chip8_vector::decimal_conversion(size_t lane, uint8_t x)
+{
+    uint8_t* ram = &memory[lane * 4096];
+    uint8_t value = V[x * width + lane];
+    uint16_t index = I[lane];
+    ram[index & 0xFFF] = value / 100;
+    ram[(index + 1) & 0xFFF] = (value / 10) % 10;
+    ram[(index + 2) & 0xFFF] = value % 10;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        written[(index + i) & 0xFFF] = true;
+    }
+}
+
+void chip8_vector::store_memory(size_t lane, uint8_t x)
+{
+    uint8_t* ram = &memory[lane * 4096];
+    for (uint8_t i = 0; i <= x; i++)
+    {
+        ram[(I[lane] + i) & 0xFFF] = V[i * width + lane];
+        written[(I[lane] + i) & 0xFFF] = true;
+    }
+
+    if (active_quirks.memory)
+        I[lane] += x + 1;
+}
+
+void chip8_vector::load_memory(size_t lane, uint8_t x)
+{
+    const uint8_t* ram = &memory[lane * 4096];
+    for (uint8_t i = 0; i <= x; i++)
+    {
+        V[i * width + lane] = ram[(I[lane] + i) & 0xFFF];
+    }
+
+    if (active_quirks.memory)
+        I[lane] += x + 1;
+}
+
+void chip8_vector::get_key(size_t lane, uint8_t x)
+{
+    key_register[lane] = x;
+    halted[lane] = 1;
+    poll_key(lane);
+    if (halted[lane])
+        remaining[lane] = 0;
+}
+
+void chip8_vector::poll_key(size_t lane)
+{
+    // Wakes once the last pressed key is released
+    int8_t key_pressed = -1;
+    for (uint8_t i = 0; i <= 0x0F; i++)
+    {
+        if ((keys[lane] >> i) & 1)
+        {
+            key_pressed = i;
+            break;
+        }
+    }
+
+    int8_t& last = pressed_key[lane];
+    if (last > -1 && ((keys[lane] >> last) & 1) == 0)
+    {
+        V[key_register[lane] * width + lane] = last;
+        last = -1;
+        halted[lane] = 0;
+    }
+
+    if (key_pressed > -1) last = key_pressed;
+}
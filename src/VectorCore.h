@@ -0,0 +1,125 @@
+#ifndef VECTOR_CORE_H
+#define VECTOR_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Core.h"
+
+// Runs many copies of one ROM in lockstep with every register stored as an array
+// across machines (lanes). Lanes at the same PC run each instruction together, the
+// ALU, timer and branch opcodes with AVX2 when it is compiled in, and a lane only
+// splits off when it branches somewhere else. Every lane gives the same results as
+// a chip8_core with the same seed and keys, using flat timing without the JIT.
+class chip8_vector
+{
+public:
+    explicit chip8_vector(size_t lanes);
+    chip8_vector(const chip8_vector&) = delete;
+    chip8_vector& operator=(const chip8_vector&) = delete;
+
+    // Setup, shared by every lane
+    void select_profile(uint8_t profile);
+    bool load(const std::string& game);
+    bool load(const uint8_t* data, size_t size);
+    void set_speed(uint32_t ips);
+
+    // Per lane input
+    void seed(size_t lane, uint32_t value);
+    void set_keys(size_t lane, uint16_t keys);
+    void reset(size_t lane);
+
+    // Runs one frame on every lane and ticks their timers
+    void run_frame();
+
+    size_t lanes() const { return count; }
+    bool pixel(size_t lane, uint8_t x, uint8_t y) const;
+    uint64_t framebuffer_hash(size_t lane) const; // Same hash as chip8_core::framebuffer_hash
+    uint16_t program_counter(size_t lane) const { return PC[lane]; }
+
+    // Every lane's display back to back, 32 rows of 64 bits each with bit 63 as x = 0
+    const uint64_t* framebuffers() const { return display.data(); }
+    // Every lane's memory back to back, 4096 bytes each
+    const uint8_t* memories() const { return memory.data(); }
+
+    uint32_t IPS; // Instructions per second
+    uint32_t IPF; // Instructions per frame, at most 65535 since budgets are kept in 16 bit lanes
+    uint32_t speed_remainder;
+
+    // Lockstep statistics, lane_instructions / group_count is the average group size
+    uint64_t group_count;       // Instructions issued for a group of lanes sharing a PC
+    uint64_t lane_instructions; // Instructions run summed over every lane
+    uint64_t split_count;       // Groups narrowed because lanes rewrote the code at PC
+    uint32_t trap_count;
+    uint32_t stack_faults;
+
+private:
+    size_t count; // Lanes
+    size_t width; // Lanes rounded up to a whole number of 32 lane blocks
+    chip8_core::quirks active_quirks;
+    std::vector<uint8_t> image; // Font and ROM, copied into a lane when it is reset
+
+    // Structure of arrays, register R of lane L is at [R * width + L]
+    std::vector<uint8_t> V;
+    std::vector<uint16_t> I;
+    std::vector<uint16_t> PC;
+    std::vector<uint8_t> DT;
+    std::vector<uint8_t> ST;
+    std::vector<uint8_t> SP;
+    std::vector<uint16_t> stack;
+    std::vector<uint16_t> remaining; // Instruction slots left in the frame, zero for padding lanes
+
+    // Per lane state only touched by the scalar opcodes
+    std::vector<uint8_t> memory;   // 4096 bytes per lane
+    std::vector<uint64_t> display; // 32 rows per lane, bit 63 is x = 0
+    std::vector<uint16_t> keys;    // Bit N holds key N
+    std::vector<uint32_t> random_seed;
+    std::vector<uint32_t> random_state;
+    std::vector<uint8_t> halted;
+    std::vector<uint8_t> key_register;
+    std::vector<int8_t> pressed_key;
+    bool written[4096]; // Addresses some lane has stored to, where lanes may hold different code
+
+    // Current group, 0xFF for each lane in it
+    std::vector<uint8_t> mask;
+    size_t group_first; // First 32 lane block with a lane in the group
+
+    void next_budget();
+    bool lowest_pc(uint16_t& pc) const;
+    size_t build_group(uint16_t pc);
+    uint16_t fetch(size_t lane, uint16_t pc) const;
+    void split_group(size_t leader, uint16_t pc);
+    template <typename action> void for_each_lane(size_t leader, action run);
+    bool idle_loop(size_t leader, uint16_t pc, uint16_t opcode);
+    void execute(size_t leader, uint16_t opcode);
+    void tick_timers();
+
+    // Vector kernels, every lane in the group at once
+    void set_register(uint8_t x, uint8_t nn);
+    void add_register(uint8_t x, uint8_t nn);
+    void logical(uint8_t x, uint8_t y, uint8_t operation);
+    void arithmetic(uint8_t x, uint8_t y, uint8_t operation);
+    void skip(uint8_t x, uint8_t y, uint8_t nn, uint8_t operation);
+    void set_index(uint16_t nnn);
+    void add_index(uint8_t x);
+    void point_font(uint8_t x);
+    void jump(uint16_t nnn);
+    void offset_jump(uint16_t nnn, uint8_t x);
+    void copy_timer(uint8_t x, uint8_t operation);
+
+    // Scalar opcodes, run lane by lane through the group
+    void clear_screen(size_t lane);
+    void call_subroutine(size_t lane, uint16_t nnn);
+    void return_from_subroutine(size_t lane);
+    void random(size_t lane, uint8_t x, uint8_t nn);
+    void draw(size_t lane, uint8_t x, uint8_t y, uint8_t n);
+    void skip_key(size_t lane, uint8_t x, bool pressed);
+    void decimal_conversion(size_t lane, uint8_t x);
+    void store_memory(size_t lane, uint8_t x);
+    void load_memory(size_t lane, uint8_t x);
+    void get_key(size_t lane, uint8_t x);
+    void poll_key(size_t lane);
+};
+
+#endif
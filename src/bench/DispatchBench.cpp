@@ -0,0 +1,193 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../Core.h"
+
+// Times the nested switch decoder the core used to have, the compile-time dispatch table
+// decoding every instruction, and the predecoded cache the core actually runs. Decoding
+// through the table is slower than the switch, whose cases compile to direct calls. The
+// core only looks the table up once per address, when it fills the predecoded cache.
+struct dispatch_benchmark
+{
+    enum decoder { nested_switch, table, predecoded };
+
+    // Quirk handlers are specialized per profile, so they go through the selected table
+    static void quirk(chip8_core& emulator, uint8_t operation, const chip8_core::micro_op& op)
+    {
+        (emulator.*emulator.active_handlers[operation])(op);
+    }
+
+    // The decoder used before the dispatch table, kept here as the reference
+    static void decode_switch(chip8_core& emulator, uint16_t opcode)
+    {
+        chip8_core::micro_op op;
+        op.opcode = opcode;
+        op.nnn = opcode & 0x0FFF;
+        op.x = (opcode & 0x0F00) >> 8;
+        op.y = (opcode & 0x00F0) >> 4;
+        op.n = opcode & 0x000F;
+        op.nn = opcode & 0x00FF;
+
+        switch (opcode & 0xF000)
+        {
+            case 0x0000:
+                switch (opcode & 0x0F00)
+                {
+                    case 0x0000:
+                        switch (opcode & 0x00FF)
+                        {
+                            case 0x00E0: emulator.clear_screen(op); break;
+                            case 0x00EE: emulator.return_from_subroutine(op); break;
+                        }
+                        break;
+                }
+                break;
+            case 0x1000: emulator.jump(op); break;
+            case 0x2000: emulator.call_subroutine(op); break;
+            case 0x3000: emulator.equal_skip(op); break;
+            case 0x4000: emulator.unequal_skip(op); break;
+            case 0x5000: emulator.equal_register_skip(op); break;
+            case 0x6000: emulator.set_vx(op); break;
+            case 0x7000: emulator.add_vx(op); break;
+            case 0x8000:
+                switch (opcode & 0x000F)
+                {
+                    case 0x0000: emulator.logical_set(op); break;
+                    case 0x0001: quirk(emulator, chip8_core::op_logical_OR, op); break;
+                    case 0x0002: quirk(emulator, chip8_core::op_logical_AND, op); break;
+                    case 0x0003: quirk(emulator, chip8_core::op_logical_XOR, op); break;
+                    case 0x0004: emulator.logical_add(op); break;
+                    case 0x0005: emulator.logical_subtract(op); break;
+                    case 0x0006: quirk(emulator, chip8_core::op_shift_right, op); break;
+                    case 0x0007: emulator.logical_subtract_reverse(op); break;
+                    case 0x000E: quirk(emulator, chip8_core::op_shift_left, op); break;
+                }
+                break;
+            case 0x9000: emulator.unequal_register_skip(op); break;
+            case 0xA000: emulator.set_index(op); break;
+            case 0xB000: quirk(emulator, chip8_core::op_offset_jump, op); break;
+            case 0xC000: emulator.random(op); break;
+            case 0xD000: quirk(emulator, chip8_core::op_draw, op); break;
+            case 0xE000:
+                switch (opcode & 0x00FF)
+                {
+                    case 0x009E: emulator.skip_if_key(op); break;
+                    case 0x00A1: emulator.skip_if_not_key(op); break;
+                }
+                break;
+            case 0xF000:
+                switch (opcode & 0x00FF)
+                {
+                    case 0x0007: emulator.get_delay_timer(op); break;
+                    case 0x0015: emulator.set_delay_timer(op); break;
+                    case 0x0018: emulator.set_sound_timer(op); break;
+                    case 0x0029: emulator.point_font(op); break;
+                    case 0x0033: emulator.decimal_conversion(op); break;
+                    case 0x0055: quirk(emulator, chip8_core::op_store_memory, op); break;
+                    case 0x0065: quirk(emulator, chip8_core::op_load_memory, op); break;
+                    case 0x001E: emulator.add_index(op); break;
+                    case 0x000A: emulator.get_key(op); break;
+                }
+                break;
+        }
+    }
+
+    // Runs the ROM for a number of frames and returns nanoseconds per executed instruction.
+    // Superinstructions and idle skipping are left out, so every mode runs the same instructions.
+    static double run(const std::string& game, uint32_t frames, uint8_t profile, decoder mode, uint64_t& checksum, uint64_t& executed)
+    {
+        chip8_core* emulator = new chip8_core();
+        emulator->select_profile(profile);
+        emulator->IPF = 1000;
+        if (!emulator->load(game))
+        {
+            delete emulator;
+            return -1.0;
+        }
+
+        executed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            // Taps a different key every half second
+            for (uint8_t key = 0; key < 16; key++)
+            {
+                emulator->keypad[key] = ((frame / 30) % 16 == key) && (frame % 30 < 10);
+            }
+
+            for (emulator->loop_index = 0; emulator->loop_index < emulator->IPF; emulator->loop_index++)
+            {
+                // Every decoder leaves a halted FX0A to execute, which polls the keypad and
+                // skips the rest of the frame
+                if (emulator->halted)
+                {
+                    emulator->loop_index += emulator->execute(emulator->IPF - emulator->loop_index) - 1;
+                    continue;
+                }
+
+                if (mode == predecoded)
+                {
+                    chip8_core::micro_op& op = emulator->decoded[emulator->PC & 0xFFF];
+                    if (op.handler == nullptr)
+                    {
+                        uint16_t program_counter = emulator->PC & 0xFFF;
+                        op = emulator->predecode(emulator->fetch(program_counter));
+                    }
+                    emulator->PC += 2;
+                    (emulator->*op.handler)(op);
+                }
+                else
+                {
+                    uint16_t opcode = emulator->fetch(emulator->PC);
+                    if (mode == table)
+                        emulator->decode(opcode);
+                    else
+                        decode_switch(*emulator, opcode);
+                }
+                executed++;
+            }
+
+            if (emulator->ST > 0) emulator->ST--;
+            if (emulator->DT > 0) emulator->DT--;
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        // Both decoders must leave the machine in the same state
+        checksum = (emulator->framebuffer_hash() ^ emulator->PC) * 1099511628211ULL;
+        delete emulator;
+
+        double elapsed = std::chrono::duration<double, std::nano>(end - start).count();
+        return executed > 0 ? elapsed / executed : 0.0;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    std::string game = argc > 1 ? argv[1] : "Release/Games/BRIX.ch8";
+    uint32_t frames = argc > 2 ? (uint32_t)atoi(argv[2]) : 20000;
+    uint8_t profile = chip8_core::find_profile(argc > 3 ? argv[3] : "modern");
+
+    uint64_t switch_checksum = 0, table_checksum = 0, predecoded_checksum = 0;
+    uint64_t switch_executed = 0, table_executed = 0, predecoded_executed = 0;
+    double switch_ns = dispatch_benchmark::run(game, frames, profile, dispatch_benchmark::nested_switch, switch_checksum, switch_executed);
+    double table_ns = dispatch_benchmark::run(game, frames, profile, dispatch_benchmark::table, table_checksum, table_executed);
+    double predecoded_ns = dispatch_benchmark::run(game, frames, profile, dispatch_benchmark::predecoded, predecoded_checksum, predecoded_executed);
+    if (switch_ns < 0 || table_ns < 0 || predecoded_ns < 0)
+    {
+        printf("Could not load %s\n", game.c_str());
+        return 1;
+    }
+
+    printf("%s, %s profile, %u frames of 1000 slots, %llu instructions executed\n", game.c_str(), chip8_core::profile_names[profile], frames, (unsigned long long)switch_executed);
+    printf("nested switch:  %.2f ns/instruction\n", switch_ns);
+    printf("dispatch table: %.2f ns/instruction (%.2fx)\n", table_ns, switch_ns / table_ns);
+    printf("predecoded:     %.2f ns/instruction (%.2fx)\n", predecoded_ns, switch_ns / predecoded_ns);
+    if (switch_checksum != table_checksum || switch_checksum != predecoded_checksum ||
+        switch_executed != table_executed || switch_executed != predecoded_executed)
+    {
+        printf("State mismatch between decoders\n");
+        return 1;
+    }
+    return 0;
+}
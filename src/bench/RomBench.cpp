@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../Core.h"
+
+// Runs every ROM in a directory headless with the same scripted input and prints a CSV
+// line per ROM, so runs from two builds can be diffed
+struct rom_benchmark
+{
+    struct result
+    {
+        uint64_t slots;        // Instruction slots, including idle and halted ones
+        uint64_t idle;
+        uint64_t halted;
+        uint64_t executed;     // Slots that ran an instruction
+        double milliseconds;   // Fastest run
+        uint64_t draws;
+        double draw_ns;        // Per DXYN, replayed on their own
+        uint64_t hash;
+    };
+
+    static uint16_t keys_at(uint32_t frame)
+    {
+        // Holds one key for 3 of every 8 frames, moving to the next key every 20 frames
+        uint16_t key = (uint16_t)((frame / 20) % 16);
+        return frame % 8 < 3 ? (uint16_t)(1 << key) : 0;
+    }
+
+    static bool start(chip8_core& emulator, const std::string& game, uint8_t profile, uint32_t ips)
+    {
+        emulator.select_profile(profile);
+        emulator.seed(1);
+        if (!emulator.load(game))
+            return false;
+        emulator.set_speed(ips);
+        return true;
+    }
+
+    struct draw_call
+    {
+        chip8_core::micro_op op;
+        uint16_t I;
+        uint8_t x;
+        uint8_t y;
+    };
+
+    static bool run(const std::string& game, uint8_t profile, uint32_t ips, uint32_t frames, uint32_t runs, bool use_jit, result& out)
+    {
+        std::unique_ptr<chip8_core> emulator(new chip8_core());
+        if (use_jit)
+            emulator->enable_jit();
+
+        // Whole frames the way the game window runs them, fastest of several runs
+        out.milliseconds = 0;
+        for (uint32_t run = 0; run < runs; run++)
+        {
+            if (!start(*emulator, game, profile, ips))
+                return false;
+
+            auto begin = std::chrono::steady_clock::now();
+            for (uint32_t frame = 0; frame < frames; frame++)
+            {
+                emulator->set_keys(keys_at(frame));
+                emulator->run_frame();
+            }
+            auto end = std::chrono::steady_clock::now();
+
+            double milliseconds = std::chrono::duration<double, std::milli>(end - begin).count();
+            if (run == 0 || milliseconds < out.milliseconds)
+                out.milliseconds = milliseconds;
+        }
+        out.slots = emulator->instruction_count;
+        out.idle = emulator->idle_instructions;
+        out.halted = emulator->halted_instructions;
+        out.executed = out.slots - out.idle - out.halted;
+        out.hash = emulator->framebuffer_hash();
+
+        // Steps through the session again one instruction at a time, noting every DXYN
+        // that drew, then times just those draws back to back
+        std::vector<draw_call> draws;
+        emulator->disable_jit();
+        start(*emulator, game, profile, ips);
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            emulator->set_keys(keys_at(frame));
+            do
+            {
+                uint16_t address = emulator->PC & 0xFFF;
+                uint16_t opcode = (emulator->memory[address] << 8) | emulator->memory[(address + 1) & 0xFFF];
+                bool draw = !emulator->halted && (opcode & 0xF000) == 0xD000;
+                draw_call call = { emulator->predecode(opcode), emulator->I, emulator->V[(opcode >> 8) & 0xF], emulator->V[(opcode >> 4) & 0xF] };
+                emulator->step();
+
+                // A draw waiting for the display does not move PC
+                if (draw && (emulator->PC & 0xFFF) != address)
+                    draws.push_back(call);
+            } while (emulator->loop_index != 0);
+        }
+
+        out.draws = draws.size();
+        out.draw_ns = 0;
+        if (draws.empty())
+            return true;
+
+        const chip8_core::opcode_handler handler = emulator->active_handlers[chip8_core::op_draw];
+        const uint32_t repeats = (uint32_t)std::max<size_t>(1, 1000000 / draws.size());
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t repeat = 0; repeat < repeats; repeat++)
+        {
+            for (const draw_call& call : draws)
+            {
+                emulator->I = call.I;
+                emulator->V[call.op.x] = call.x;
+                emulator->V[call.op.y] = call.y;
+                emulator->loop_index = 0;
+                (emulator.get()->*handler)(call.op);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        out.draw_ns = std::chrono::duration<double, std::nano>(end - begin).count() / ((double)repeats * draws.size());
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    std::string directory = "Release/Games";
+    uint32_t frames = 3600;
+    // Display wait ends a frame at its first DXYN, which leaves little to time
+    uint8_t profile = chip8_core::profile_modern;
+    uint32_t ips = 60000;
+    uint32_t runs = 3;
+    bool use_jit = false;
+
+    // rom_bench [directory] [frames] [profile] [IPS] [--jit]
+    int position = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jit") == 0)
+        {
+            use_jit = true;
+            continue;
+        }
+        switch (position++)
+        {
+            case 0: directory = argv[i]; break;
+            case 1: frames = (uint32_t)atoi(argv[i]); break;
+            case 2: profile = chip8_core::find_profile(argv[i]); break;
+            case 3: ips = (uint32_t)atoi(argv[i]); break;
+        }
+    }
+
+    std::vector<std::string> games;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.path().extension() == ".ch8")
+            games.push_back(entry.path().string());
+    }
+    std::sort(games.begin(), games.end());
+    if (games.empty())
+    {
+        fprintf(stderr, "No .ch8 files in %s\n", directory.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "%zu ROMs, %s profile, %u frames at %u IPS, %s\n", games.size(),
+        chip8_core::profile_names[profile], frames, ips, use_jit ? "JIT" : "interpreter");
+    printf("rom,slots,idle,halted,executed,milliseconds,ips,ns_per_instruction,draws,ns_per_draw,framebuffer\n");
+    for (const std::string& game : games)
+    {
+        rom_benchmark::result result;
+        if (!rom_benchmark::run(game, profile, ips, frames, runs, use_jit, result))
+        {
+            fprintf(stderr, "Could not load %s\n", game.c_str());
+            continue;
+        }
+
+        // Idle and halted slots are skipped without running, so the rates only count executed instructions
+        double seconds = result.milliseconds / 1000.0;
+        double executed = result.executed > 0 ? (double)result.executed : 1.0;
+        printf("%s,%llu,%llu,%llu,%llu,%.3f,%.0f,%.3f,%llu,%.1f,%016llx\n",
+            std::filesystem::path(game).filename().string().c_str(),
+            (unsigned long long)result.slots, (unsigned long long)result.idle, (unsigned long long)result.halted,
+            (unsigned long long)result.executed, result.milliseconds, result.executed / seconds, result.milliseconds * 1000000.0 / executed,
+            (unsigned long long)result.draws, result.draw_ns, (unsigned long long)result.hash);
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "../Core.h"
+#include "../VectorCore.h"
+
+// Compares one chip8_vector against the same number of chip8_core machines run one after another
+enum input { same_keys, mixed_keys };
+
+static uint16_t keys_at(input pattern, size_t lane, uint32_t frame)
+{
+    // Every lane presses one key for a few frames at a time, mixed keys offset it per lane
+    size_t offset = pattern == mixed_keys ? lane : 0;
+    uint16_t key = (uint16_t)((frame / 20 + offset) % 16);
+    return (frame + offset) % 8 < 3 ? (uint16_t)(1 << key) : 0;
+}
+
+struct result
+{
+    double ns;              // Per lane instruction
+    uint64_t checksum;      // Over every lane's display and PC
+    double group_size;
+};
+
+static uint64_t mix(uint64_t hash, uint64_t value)
+{
+    return (hash ^ value) * 1099511628211ULL;
+}
+
+static bool run_scalar(const std::string& game, size_t lanes, uint32_t frames, uint8_t profile, input pattern, result& out)
+{
+    std::vector<std::unique_ptr<chip8_core>> machines;
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        machines.emplace_back(new chip8_core());
+        machines[lane]->select_profile(profile);
+        machines[lane]->set_speed(60000);
+        machines[lane]->seed((uint32_t)lane + 1);
+        if (!machines[lane]->load(game))
+            return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            machines[lane]->set_keys(keys_at(pattern, lane, frame));
+            machines[lane]->run_frame();
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    out.checksum = 1469598103934665603ULL;
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        out.checksum = mix(mix(out.checksum, machines[lane]->framebuffer_hash()), machines[lane]->PC);
+    }
+    out.ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)frames * 1000 * lanes);
+    out.group_size = 1;
+    return true;
+}
+
+static bool run_vector(const std::string& game, size_t lanes, uint32_t frames, uint8_t profile, input pattern, result& out)
+{
+    chip8_vector machines(lanes);
+    machines.select_profile(profile);
+    machines.set_speed(60000);
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        machines.seed(lane, (uint32_t)lane + 1);
+    }
+    if (!machines.load(game))
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            machines.set_keys(lane, keys_at(pattern, lane, frame));
+        }
+        machines.run_frame();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    out.checksum = 1469598103934665603ULL;
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        out.checksum = mix(mix(out.checksum, machines.framebuffer_hash(lane)), machines.program_counter(lane));
+    }
+    out.ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)frames * 1000 * lanes);
+    out.group_size = machines.group_count > 0 ? (double)machines.lane_instructions / machines.group_count : 0;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string game = argc > 1 ? argv[1] : "Release/Games/BRIX.ch8";
+    size_t lanes = argc > 2 ? (size_t)atoi(argv[2]) : 256;
+    uint32_t frames = argc > 3 ? (uint32_t)atoi(argv[3]) : 200;
+    uint8_t profile = chip8_core::find_profile(argc > 4 ? argv[4] : "modern");
+
+#if defined(__AVX2__)
+    const char* kernels = "AVX2";
+#else
+    const char* kernels = "portable";
+#endif
+    printf("%s, %s profile, %zu lanes, %u frames of 1000 instructions, %s kernels\n",
+        game.c_str(), chip8_core::profile_names[profile], lanes, frames, kernels);
+
+    const char* names[] = { "same keys ", "mixed keys" };
+    bool mismatch = false;
+    for (int pattern = same_keys; pattern <= mixed_keys; pattern++)
+    {
+        result scalar, vector;
+        if (!run_scalar(game, lanes, frames, profile, (input)pattern, scalar) ||
+            !run_vector(game, lanes, frames, profile, (input)pattern, vector))
+        {
+            printf("Could not load %s\n", game.c_str());
+            return 1;
+        }
+
+        printf("%s  chip8_core: %.2f ns/instruction  chip8_vector: %.2f ns/instruction (%.2fx, %.1f lanes per group)\n",
+            names[pattern], scalar.ns, vector.ns, scalar.ns / vector.ns, vector.group_size);
+        if (scalar.checksum != vector.checksum)
+            mismatch = true;
+    }
+
+    // Every lane must end in the same state as its scalar machine
+    if (mismatch)
+    {
+        printf("State mismatch between chip8_core and chip8_vector\n");
+        return 1;
+    }
+    return 0;
+}
@@ -69,11 +69,16 @@ int main(int, char**)
 
     // Initialize variables
     bool show_settings_window = false;
+#ifdef CHIP8_PROFILER
+    bool show_profiler_window = false;
+#endif
     bool fullscreen_on = false;
     bool start_games_fullscreen;
-    bool display_wait;
-    bool logic_quirk;
-    bool wrapping_quirk;
+    int profile;
+    bool jit_recompiler;
+    bool vip_timing;
+    int run_ahead;
+    int fast_forward_speed;
     int volume;
     int IPS_value;
     ImVec4 pixel_on_color = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
@@ -94,11 +99,13 @@ int main(int, char**)
         config_file.close();
 
         volume = config["volume"];
-        display_wait = config["display_wait"];
         IPS_value = config["IPS"];
-        logic_quirk = config["logic"];
-        wrapping_quirk = config["wrapping"];
+        profile = chip8::profile_from_config(config);
         start_games_fullscreen = config["start_games_fullscreen"];
+        jit_recompiler = config.value("jit", false);
+        vip_timing = config.value("vip_timing", false);
+        run_ahead = config.value("run_ahead", 0);
+        fast_forward_speed = config.value("fast_forward_speed", 4);
 
         // Normalized 
         pixel_on_color.x = config["pixel_on_color_R"] / 255.0f;   // Red
@@ -121,22 +128,26 @@ int main(int, char**)
         config["pixel_off_color_G"] = 102;
         config["pixel_off_color_B"] = 1;
         config["volume"] = 100;
-        config["display_wait"] = false;
         config["IPS"] = 700;
-        config["logic"] = true;
-        config["wrapping"] = false;
+        config["profile"] = chip8::profile_names[chip8::profile_cosmac_vip];
         config["start_games_fullscreen"] = false;
+        config["jit"] = false;
+        config["vip_timing"] = false;
+        config["run_ahead"] = 0;
+        config["fast_forward_speed"] = 4;
 
         std::ofstream newConfigFile("config.json");
         newConfigFile << std::setw(4) << config;
         newConfigFile.close();
 
         volume = config["volume"];
-        display_wait = config["display_wait"];
         IPS_value = config["IPS"];
-        logic_quirk = config["logic"];
-        wrapping_quirk = config["wrapping"];
+        profile = chip8::profile_from_config(config);
         start_games_fullscreen = config["start_games_fullscreen"];
+        jit_recompiler = config["jit"];
+        vip_timing = config["vip_timing"];
+        run_ahead = config["run_ahead"];
+        fast_forward_speed = config["fast_forward_speed"];
 
         // Normalized
         pixel_on_color.x = config["pixel_on_color_R"] / 255.0f;   // Red
@@ -288,6 +299,12 @@ int main(int, char**)
                 {
                     show_settings_window = true;
                 }
+#ifdef CHIP8_PROFILER
+                if (ImGui::MenuItem("Profiler"))
+                {
+                    show_profiler_window = true;
+                }
+#endif
                 ImGui::EndMenu();
             }
             // End the menu bar
@@ -328,25 +345,49 @@ int main(int, char**)
                     ImGui::SetTooltip("The rate at which the emulator executes instructions within a second. Recommended IPS is 600-800");
                 }
 
-                ImGui::Text("Emulator Quirks");
+                ImGui::Checkbox("JIT Recompiler", &jit_recompiler);
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Translates the game into native x86-64 code. Only worth it at very high IPS.");
+                }
+
+                ImGui::Checkbox("COSMAC VIP Timing", &vip_timing);
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Runs each instruction for as long as it took on the COSMAC VIP instead of a flat IPS.\n"
+                                      "Games run at their original speed without tuning IPS.");
+                }
 
-                // Toggle Display wait
-                ImGui::Checkbox("Display Wait", &display_wait);
+                ImGui::Text("Run-ahead frames");
+                ImGui::SliderInt("##RunAhead", &run_ahead, 0, 4);
                 if (ImGui::IsItemHovered())
                 {
-                    ImGui::SetTooltip("Display wait is a way to better emulate the behaviour of the original CHIP-8 interpreter on the COSMAC VIP.");
+                    ImGui::SetTooltip("Shows the game this many frames ahead of the real machine, so key presses appear sooner.\n"
+                                      "Each frame ahead runs the game once more, recommended is 1-2.");
                 }
 
-                ImGui::Checkbox("Logic Quirk", &logic_quirk);
+                ImGui::Text("Fast-forward speed");
+                ImGui::SliderInt("##FastForward", &fast_forward_speed, 2, 16);
                 if (ImGui::IsItemHovered())
                 {
-                    ImGui::SetTooltip("If false, The VF register is not touched when performing logical operations. This is used for modern Chip-8 games");
+                    ImGui::SetTooltip("How many times faster the game runs while Tab is held.");
                 }
 
-                ImGui::Checkbox("Wrapping Quirk", &wrapping_quirk);
+                ImGui::Text("Platform Profile");
+
+                // Each profile sets the CHIP-8 quirks of one of the original platforms
+                // A config from before profiles keeps its old quirks until another profile is picked
+                const char* profile_labels[] = { "COSMAC VIP", "CHIP-48", "SUPER-CHIP", "Modern", "Old settings" };
+                bool legacy = profile >= chip8::profile_legacy;
+                int choice = legacy ? 4 : profile;
+                if (ImGui::Combo("##Profile", &choice, profile_labels, legacy ? 5 : 4) && choice < 4)
+                    profile = choice;
                 if (ImGui::IsItemHovered())
                 {
-                    ImGui::SetTooltip("Sprites that go beyond the boundaries of the display area reappear on the opposite side.");
+                    ImGui::SetTooltip("COSMAC VIP emulates the original CHIP-8 interpreter, including display wait and the VF reset.\n"
+                                      "CHIP-48 and SUPER-CHIP shift VX in place and jump to XNN + VX.\n"
+                                      "Modern wraps sprites around the screen and leaves VF alone on logical operations.\n"
+                                      "Old settings keeps the display wait, logic and wrapping switches of a config from an older version.");
                 }
 
                 if (ImGui::Button("Close")) {
@@ -362,10 +403,12 @@ int main(int, char**)
                     config["pixel_off_color_G"] = (int)(pixel_off_color.y * 255);
                     config["pixel_off_color_B"] = (int)(pixel_off_color.z * 255);
                     config["volume"] = volume;
-                    config["display_wait"] = display_wait;
-                    config["logic"] = logic_quirk;
-                    config["wrapping"] = wrapping_quirk;
+                    config["profile"] = chip8::profile_names[profile];
                     config["IPS"] = IPS_value;
+                    config["jit"] = jit_recompiler;
+                    config["vip_timing"] = vip_timing;
+                    config["run_ahead"] = run_ahead;
+                    config["fast_forward_speed"] = fast_forward_speed;
 
                     std::ofstream fileStream(current_directory + "\\config.json");
                     fileStream << std::setw(4) << config << std::endl;
@@ -376,6 +419,11 @@ int main(int, char**)
             ImGui::End();
         }
 
+#ifdef CHIP8_PROFILER
+        if (show_profiler_window)
+            ShowProfilerWindow(&show_profiler_window, emulator);
+#endif
+
         // Games list
         ImGui::Text("List of Games:");
 
@@ -560,3 +608,86 @@ void SetupImGuiStyle()
     style.Colors[ImGuiCol_NavWindowingDimBg] = ImVec4(0.196078434586525f, 0.1764705926179886f, 0.5450980663299561f, 0.501960813999176f);
     style.Colors[ImGuiCol_ModalWindowDimBg] = ImVec4(0.196078434586525f, 0.1764705926179886f, 0.5450980663299561f, 0.501960813999176f);
 }
+
+#ifdef CHIP8_PROFILER
+void ShowProfilerWindow(bool* open, const chip8& emulator)
+{
+    ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+
+    if (ImGui::Begin("Profiler", open, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove))
+    {
+        // Profile of the last game that ran, it is also written next to the ROM as <game>.profile.json
+        profile_report report(emulator);
+        ImGui::Text("Instructions: %llu, idle: %llu, waiting for keys: %llu",
+            (unsigned long long)report.instructions, (unsigned long long)report.idle, (unsigned long long)report.halted);
+        uint64_t draws = report.operations[chip8::op_draw];
+        ImGui::Text("DXYN: %llu draws, %.3f ms, %.0f ns per draw", (unsigned long long)draws,
+            report.draw_ns / 1000000.0, draws > 0 ? (double)report.draw_ns / draws : 0.0);
+
+        const ImGuiTableFlags table_flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+        const float table_height = ImGui::GetContentRegionAvail().y - ImGui::GetFrameHeightWithSpacing() * 1.5f;
+        const double total = report.instructions > 0 ? (double)report.instructions : 1.0;
+
+        // Opcode classes by how often they ran
+        if (ImGui::BeginTable("##Operations", 3, table_flags, ImVec2(ImGui::GetContentRegionAvail().x * 0.35f, table_height)))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Opcode");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("Share");
+            ImGui::TableHeadersRow();
+
+            uint8_t order[chip8::op_count];
+            for (uint8_t i = 0; i < chip8::op_count; i++)
+            {
+                order[i] = i;
+            }
+            std::stable_sort(order, order + chip8::op_count,
+                [&report](uint8_t a, uint8_t b) { return report.operations[a] > report.operations[b]; });
+            for (uint8_t i = 0; i < chip8::op_count && report.operations[order[i]] > 0; i++)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%s", chip8::operation_names[order[i]]);
+                ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)report.operations[order[i]]);
+                ImGui::TableNextColumn(); ImGui::Text("%.2f%%", report.operations[order[i]] / total * 100.0);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::SameLine();
+
+        // Hottest addresses first
+        if (ImGui::BeginTable("##HotSpots", 5, table_flags, ImVec2(0, table_height)))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Address");
+            ImGui::TableSetupColumn("Opcode");
+            ImGui::TableSetupColumn("Class");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("Share");
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin((int)report.hot_spots.size());
+            while (clipper.Step())
+            {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                {
+                    const profile_report::hot_spot& spot = report.hot_spots[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%03X", spot.address);
+                    ImGui::TableNextColumn(); ImGui::Text("%04X", spot.opcode);
+                    ImGui::TableNextColumn(); ImGui::Text("%s", chip8::operation_names[spot.operation]);
+                    ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)spot.count);
+                    ImGui::TableNextColumn(); ImGui::Text("%.2f%%", spot.count / total * 100.0);
+                }
+            }
+            ImGui::EndTable();
+        }
+
+        if (ImGui::Button("Close"))
+            *open = false;
+    }
+    ImGui::End();
+}
+#endif
@@ -20,9 +20,13 @@
 #include <vector>
 
 #include "Emulator.h"
+#include "Profiler.h"
 
 std::string LoadROM();
 void SetupImGuiStyle();
 std::vector<std::string> GetCh8FileNames(const std::string& folderPath);
+#ifdef CHIP8_PROFILER
+void ShowProfilerWindow(bool* open, const chip8& emulator);
+#endif
 
 #endif
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Core.h"
+#include "InputScript.h"
+#include "WorkPool.h"
+
+// Runs a list of headless ROM sessions across every core and prints a CSV line per job.
+// Each line of the job file is "<rom> <profile> <input script or -> <frames> [IPS]".
+struct batch_job
+{
+    std::string rom;
+    std::string profile;
+    std::string input;
+    uint32_t frames;
+    uint32_t IPS;
+
+    // Results
+    bool loaded;
+    uint64_t hash;
+    double milliseconds;
+    uint64_t instructions; // Executed, without idle and halted slots
+};
+
+static bool read_jobs(const std::string& path, std::vector<batch_job>& jobs)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        batch_job job = {};
+        fields >> job.rom >> job.profile >> job.input >> job.frames;
+        if (fields.fail())
+        {
+            fprintf(stderr, "Skipping malformed job: %s\n", line.c_str());
+            continue;
+        }
+        if (!(fields >> job.IPS))
+            job.IPS = 700;
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+static void run_job(batch_job& job)
+{
+    // Every job gets its own core, so nothing is shared between threads
+    std::unique_ptr<chip8_core> core(new chip8_core());
+    core->select_profile(chip8_core::find_profile(job.profile));
+    core->set_speed(job.IPS);
+
+    input_script script;
+    job.loaded = core->load(job.rom) && (job.input == "-" || script.load(job.input));
+    if (!job.loaded)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < job.frames; frame++)
+    {
+        if (job.input != "-")
+            core->set_keys(script.keys_at(frame));
+        core->run_frame();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    job.hash = core->framebuffer_hash();
+    job.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    // Idle and halted slots are skipped without running, so they do not count towards MIPS
+    job.instructions = core->instruction_count - core->idle_instructions - core->halted_instructions;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <job file> [threads]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<batch_job> jobs;
+    if (!read_jobs(argv[1], jobs))
+    {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    unsigned threads = argc > 2 ? (unsigned)atoi(argv[2]) : std::thread::hardware_concurrency();
+    work_pool pool(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run(jobs.size(), [&jobs](size_t i) { run_job(jobs[i]); });
+    auto end = std::chrono::steady_clock::now();
+
+    printf("job,rom,profile,frames,hash,ms,mips\n");
+    uint64_t instructions = 0;
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const batch_job& job = jobs[i];
+        if (!job.loaded)
+        {
+            printf("%zu,%s,%s,%u,error,,\n", i, job.rom.c_str(), job.profile.c_str(), job.frames);
+            failed++;
+            continue;
+        }
+
+        double mips = job.milliseconds > 0 ? job.instructions / job.milliseconds / 1000.0 : 0.0;
+        printf("%zu,%s,%s,%u,%016llx,%.3f,%.2f\n", i, job.rom.c_str(), job.profile.c_str(), job.frames,
+            (unsigned long long)job.hash, job.milliseconds, mips);
+        instructions += job.instructions;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    fprintf(stderr, "%zu jobs on %u threads in %.3f s, %.2f MIPS combined, %d failed\n",
+        jobs.size(), threads > 0 ? threads : 1, seconds, instructions / seconds / 1000000.0, failed);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Core.h"
+#include "InputScript.h"
+#include "WorkPool.h"
+
+// Runs test ROMs headless under the given profiles and compares the final framebuffer
+// against the golden in the case file. Each line of the case file is
+// "<rom> <profile> <input script or -> <frames> <IPS> <golden>", where the golden is a
+// framebuffer hash, a screen file or "-". A screen file is 32 lines of 64 characters,
+// '#' for a lit pixel, '.' for a dark one and '?' for either. A missing ROM, a "-"
+// golden or a screen file that does not exist yet fails the run, so a case can never
+// pass without being checked. --update fills in hashes and writes screen files.
+struct conformance_case
+{
+    size_t line;
+    std::string rom;
+    std::string profile;
+    std::string input;
+    uint32_t frames;
+    uint32_t IPS;
+    std::string golden;
+    bool screen_golden; // The golden names a screen file
+    std::string screen; // 32 * 64 expected pixels, empty until the screen file exists
+
+    // Results
+    bool found;
+    bool loaded;
+    uint64_t hash;
+    chip8_core::frame display;
+};
+
+static bool is_hash(const std::string& golden)
+{
+    return golden.size() == 16 && golden.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+static bool read_screen(const std::string& path, std::string& screen)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    screen.clear();
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.size() != 64 || line.find_first_not_of("#.?") != std::string::npos)
+            return false;
+        screen += line;
+    }
+    return screen.size() == 32 * 64;
+}
+
+static bool matches_screen(const conformance_case& test)
+{
+    for (int y = 0; y < 32; y++)
+    {
+        for (int x = 0; x < 64; x++)
+        {
+            char expected = test.screen[y * 64 + x];
+            bool lit = (test.display[y] >> (63 - x)) & 1;
+            if (expected != '?' && lit != (expected == '#'))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool read_cases(const std::string& path, std::vector<std::string>& lines, std::vector<conformance_case>& cases)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        lines.push_back(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        conformance_case test = {};
+        test.line = lines.size() - 1;
+        fields >> test.rom >> test.profile >> test.input >> test.frames >> test.IPS >> test.golden;
+        if (fields.fail())
+        {
+            fprintf(stderr, "Malformed case on line %zu: %s\n", lines.size(), line.c_str());
+            return false;
+        }
+        test.screen_golden = test.golden != "-" && !is_hash(test.golden);
+        if (test.screen_golden && std::ifstream(test.golden).good() && !read_screen(test.golden, test.screen))
+        {
+            fprintf(stderr, "Malformed screen %s on line %zu\n", test.golden.c_str(), lines.size());
+            return false;
+        }
+        cases.push_back(test);
+    }
+    return true;
+}
+
+static std::string screen_rows(const chip8_core::frame& display)
+{
+    std::string rows;
+    for (int y = 0; y < 32; y++)
+    {
+        for (int x = 0; x < 64; x++)
+        {
+            rows += (display[y] >> (63 - x)) & 1 ? '#' : '.';
+        }
+        rows += '\n';
+    }
+    return rows;
+}
+
+static void run_case(conformance_case& test, bool use_jit)
+{
+    test.found = std::ifstream(test.rom).good();
+    if (!test.found)
+        return;
+
+    std::unique_ptr<chip8_core> core(new chip8_core());
+    if (use_jit)
+        core->enable_jit();
+    core->select_profile(chip8_core::find_profile(test.profile));
+    core->seed(1);
+
+    input_script script;
+    test.loaded = core->load(test.rom) && (test.input == "-" || script.load(test.input));
+    if (!test.loaded)
+        return;
+    core->set_speed(test.IPS);
+
+    for (uint32_t frame = 0; frame < test.frames; frame++)
+    {
+        if (test.input != "-")
+            core->set_keys(script.keys_at(frame));
+        core->run_frame();
+    }
+    test.hash = core->framebuffer_hash();
+    memcpy(test.display, core->framebuffer(), sizeof(test.display));
+}
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    bool update = false;
+    bool use_jit = false;
+    unsigned threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--update") == 0)
+            update = true;
+        else if (strcmp(argv[i], "--jit") == 0)
+            use_jit = true;
+        else if (path.empty())
+            path = argv[i];
+        else
+            threads = (unsigned)atoi(argv[i]);
+    }
+    if (path.empty())
+    {
+        fprintf(stderr, "Usage: %s <case file> [threads] [--jit] [--update]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> lines;
+    std::vector<conformance_case> cases;
+    if (!read_cases(path, lines, cases))
+    {
+        fprintf(stderr, "Could not read the cases in %s\n", path.c_str());
+        return 2;
+    }
+
+    work_pool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    pool.run(cases.size(), [&cases, use_jit](size_t i) { run_case(cases[i], use_jit); });
+    auto end = std::chrono::steady_clock::now();
+
+    int passed = 0, failed = 0, errors = 0, fresh = 0, updated = 0;
+    bool rewritten = false;
+    for (conformance_case& test : cases)
+    {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)test.hash);
+
+        if (!test.found)
+        {
+            printf("ERROR %s %s: ROM not found\n", test.rom.c_str(), test.profile.c_str());
+            errors++;
+            continue;
+        }
+        if (!test.loaded)
+        {
+            printf("ERROR %s %s: could not load the ROM or %s\n", test.rom.c_str(), test.profile.c_str(), test.input.c_str());
+            errors++;
+            continue;
+        }
+        bool matches = test.screen_golden ? !test.screen.empty() && matches_screen(test) : test.golden == hash;
+        if (matches)
+        {
+            passed++;
+            continue;
+        }
+
+        std::string screen = screen_rows(test.display);
+        if (test.golden == "-" || (test.screen_golden && test.screen.empty()))
+        {
+            printf("NEW   %s %s: %s\n", test.rom.c_str(), test.profile.c_str(), hash);
+            fresh++;
+        }
+        else if (test.screen_golden)
+        {
+            printf("FAIL  %s %s: screen differs from %s, got %s\n", test.rom.c_str(), test.profile.c_str(), test.golden.c_str(), hash);
+            failed++;
+        }
+        else
+        {
+            printf("FAIL  %s %s: expected %s, got %s\n", test.rom.c_str(), test.profile.c_str(), test.golden.c_str(), hash);
+            failed++;
+        }
+        if (test.screen_golden)
+        {
+            std::istringstream rows(screen);
+            std::string row;
+            while (std::getline(rows, row))
+            {
+                printf("      %s\n", row.c_str());
+            }
+        }
+
+        if (!update)
+            continue;
+        if (test.screen_golden)
+        {
+            std::ofstream file(test.golden, std::ios::binary);
+            file << screen;
+            if (!file.good())
+            {
+                fprintf(stderr, "Could not write %s\n", test.golden.c_str());
+                errors++;
+                continue;
+            }
+        }
+        else
+        {
+            // Rewrites just this case's line with the new hash, comments and order stay as they are
+            std::ostringstream line;
+            line << test.rom << ' ' << test.profile << ' ' << test.input << ' ' << test.frames << ' ' << test.IPS << ' ' << hash;
+            lines[test.line] = line.str();
+            rewritten = true;
+        }
+        updated++;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    fprintf(stderr, "%zu cases on %u threads in %.3f s%s: %d passed, %d failed, %d errors, %d without a golden\n",
+        cases.size(), threads > 0 ? threads : 1, seconds, use_jit ? " with the JIT" : "", passed, failed, errors, fresh);
+
+    if (rewritten)
+    {
+        std::ofstream file(path, std::ios::binary);
+        for (const std::string& line : lines)
+        {
+            file << line << '\n';
+        }
+        if (!file.good())
+        {
+            fprintf(stderr, "Could not write %s\n", path.c_str());
+            return 2;
+        }
+    }
+    if (updated > 0)
+        fprintf(stderr, "Updated %d goldens\n", updated);
+    return failed + fresh + errors > updated ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "InputScript.h"
+
+bool input_script::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+
+    events.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // Blank lines and # comments are skipped
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        event input;
+        fields >> input.frame >> std::hex >> input.keys;
+        if (fields.fail())
+            return false;
+        events.push_back(input);
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const event& a, const event& b) { return a.frame < b.frame; });
+    next = 0;
+    keys = 0;
+    return true;
+}
+
+uint16_t input_script::keys_at(uint32_t frame)
+{
+    // Frames are asked for in order, so this only walks forward
+    while (next < events.size() && events[next].frame <= frame)
+    {
+        keys = events[next].keys;
+        next++;
+    }
+    return keys;
+}
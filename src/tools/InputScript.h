@@ -0,0 +1,27 @@
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Keypad input for headless runs. Each line of a script is "<frame> <hex key mask>",
+// and the mask holds from that frame until the next line.
+class input_script
+{
+public:
+    bool load(const std::string& path);
+    uint16_t keys_at(uint32_t frame);
+
+private:
+    struct event
+    {
+        uint32_t frame;
+        uint16_t keys;
+    };
+    std::vector<event> events; // Sorted by frame
+    size_t next = 0;           // First event not yet reached
+    uint16_t keys = 0;
+};
+
+#endif
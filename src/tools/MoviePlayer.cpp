@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "../Core.h"
+#include "../Movie.h"
+#include "../Profiler.h"
+
+// Replays a movie recorded in the game window as fast as possible, then checks the
+// final instruction count and framebuffer against the recording. Every run replays
+// the whole movie from power on, and the fastest run is reported.
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <rom> <movie> [runs] [--jit] [--profile <json>]\n", argv[0]);
+        return 2;
+    }
+
+    std::string game = argv[1];
+    input_movie movie;
+    if (!movie.load(argv[2]))
+    {
+        fprintf(stderr, "Could not read movie %s\n", argv[2]);
+        return 2;
+    }
+
+    int runs = 1;
+    bool use_jit = false;
+    std::string profile_path;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jit") == 0)
+            use_jit = true;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            profile_path = argv[++i];
+        else
+            runs = atoi(argv[i]) > 0 ? atoi(argv[i]) : 1;
+    }
+
+    std::unique_ptr<chip8_core> core(new chip8_core());
+    if (use_jit && !core->enable_jit())
+        fprintf(stderr, "JIT recompiler unavailable, using the interpreter\n");
+
+    printf("%s, %s profile, %u frames, %zu key changes, %s timing at %u IPS, seed %u\n",
+        game.c_str(), chip8_core::profile_names[movie.profile], movie.frames, movie.events(),
+        movie.timing == chip8_core::timing_vip ? "COSMAC VIP" : "flat", movie.IPS, movie.seed);
+
+    double best = 0;
+    for (int run = 0; run < runs; run++)
+    {
+        if (!movie.setup(*core, game))
+        {
+            fprintf(stderr, "Could not load %s, or the movie was recorded with another ROM\n", game.c_str());
+            return 2;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        while (movie.play_frame(*core))
+        {
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+        if (run == 0 || milliseconds < best)
+            best = milliseconds;
+
+        if (movie.desynced)
+        {
+            printf("Desync at frame %u: keys arrived after a different number of instructions\n", movie.position());
+            return 1;
+        }
+    }
+
+    double seconds = best / 1000.0;
+    printf("%.2f ms, %.2f MIPS, %.0fx real time\n", best,
+        core->instruction_count / seconds / 1000000.0, movie.frames / 60.0 / seconds);
+    printf("instructions %llu, framebuffer %016llx\n",
+        (unsigned long long)core->instruction_count, (unsigned long long)core->framebuffer_hash());
+
+    // The profile covers the last run only, each run starts again from power on
+    if (!profile_path.empty())
+    {
+#ifdef CHIP8_PROFILER
+        if (!profile_report(*core).save(profile_path, game))
+            fprintf(stderr, "Could not write %s\n", profile_path.c_str());
+#else
+        fprintf(stderr, "Not built with the profiler, rebuild with make PROFILER=1\n");
+#endif
+    }
+
+    if (!movie.matches(*core))
+    {
+        printf("Mismatch, recorded instructions %llu, framebuffer %016llx\n",
+            (unsigned long long)movie.final_instructions, (unsigned long long)movie.final_hash);
+        return 1;
+    }
+    printf("Matches the recording\n");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <thread>
+#include "WorkPool.h"
+
+work_pool::work_pool(unsigned threads) : queues(threads > 0 ? threads : 1)
+{
+}
+
+void work_pool::run(size_t count, const std::function<void(size_t)>& task)
+{
+    // Deals the tasks out round robin, stealing evens out whatever is left
+    for (size_t i = 0; i < count; i++)
+    {
+        queues[i % queues.size()].tasks.push_back(i);
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        threads.emplace_back(&work_pool::work, this, i, std::cref(task));
+    }
+    work(0, task);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+bool work_pool::pop(size_t owner, size_t& task)
+{
+    std::lock_guard<std::mutex> guard(queues[owner].lock);
+    if (queues[owner].tasks.empty())
+        return false;
+
+    task = queues[owner].tasks.back();
+    queues[owner].tasks.pop_back();
+    return true;
+}
+
+bool work_pool::steal(size_t thief, size_t& task)
+{
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        queue& victim = queues[(thief + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void work_pool::work(size_t owner, const std::function<void(size_t)>& task)
+{
+    // No tasks are added while running, so empty queues everywhere means done
+    size_t next;
+    while (pop(owner, next) || steal(owner, next))
+    {
+        task(next);
+    }
+}
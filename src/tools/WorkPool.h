@@ -0,0 +1,31 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+// Runs numbered tasks across threads. Every thread works through its own deque
+// and steals from the other end of another thread's deque once it runs dry.
+class work_pool
+{
+public:
+    explicit work_pool(unsigned threads);
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    struct queue
+    {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+    std::vector<queue> queues;
+
+    bool pop(size_t owner, size_t& task);
+    bool steal(size_t thief, size_t& task);
+    void work(size_t owner, const std::function<void(size_t)>& task);
+};
+
+#endif